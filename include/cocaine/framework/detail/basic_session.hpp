@@ -16,7 +16,9 @@
 
 #pragma once
 
+#include <chrono>
 #include <cstdint>
+#include <deque>
 #include <unordered_map>
 
 #include <boost/asio/ip/tcp.hpp>
@@ -56,13 +58,33 @@ class basic_session_t:
     typedef protocol_type::socket socket_type;
     typedef io::transport<protocol_type, io::encoder_t, detail::decoder_t> transport_type;
 
-    typedef std::unordered_map<
-        std::uint64_t,
-        std::shared_ptr<shared_state_t>
-    > channel_map_type;
+    struct channel_t {
+        std::shared_ptr<shared_state_t> state;
+
+        /// Invocation time point. Reset after the first response message is received.
+        std::chrono::steady_clock::time_point birth;
+    };
+
+    typedef std::unordered_map<std::uint64_t, channel_t> channel_map_type;
 
     class push_t;
 
+    /// Frames waiting to be handed to the transport, see \sa push.
+    struct outbound_t {
+        /// Whether a bulk frame is being written, while other frames are queued.
+        bool busy;
+
+        std::deque<std::shared_ptr<push_t>> urgent;
+        std::deque<std::shared_ptr<push_t>> bulk;
+
+        /// Number of bulk frames queued or being written for each channel.
+        std::unordered_map<std::uint64_t, std::size_t> pending;
+
+        outbound_t() :
+            busy(false)
+        {}
+    };
+
 public:
     typedef boost::asio::ip::tcp::endpoint endpoint_type;
 
@@ -92,9 +114,16 @@ private:
 
     synchronized<std::shared_ptr<transport_type>> transport;
     synchronized<channel_map_type> channels;
+    synchronized<outbound_t> outbound;
+
+    /// The peer of the last successful connection.
+    synchronized<boost::optional<endpoint_type>> peer;
 
     std::atomic<bool> hard_shutdown_;
 
+    /// Exponentially weighted moving average of the response latency in microseconds.
+    std::atomic<std::uint64_t> latency_;
+
     std::mutex mutex;
 
 public:
@@ -123,8 +152,8 @@ public:
 
     auto hard_shutdown(bool policy) -> void;
 
-    /// Returns the endpoint of the connected peer if the session is in connected state; otherwise
-    /// returns none.
+    /// Returns the endpoint of the peer the session is connected to, or was connected to the last
+    /// time before the connection was lost; returns none if the session has never been connected.
     ///
     /// \threadsafe
     boost::optional<endpoint_type>
@@ -133,6 +162,17 @@ public:
     native_handle_type
     native_handle() const;
 
+    /// Returns the number of channels currently registered in this session.
+    ///
+    /// \threadsafe
+    auto inflight() const -> std::size_t;
+
+    /// Returns the smoothed time between sending an invocation event and receiving the first
+    /// response message for it, or zero if nothing has been received yet.
+    ///
+    /// \threadsafe
+    auto latency() const noexcept -> std::chrono::microseconds;
+
     /// Cancels the current session, moving it to the disconnected unrecoverable state.
     ///
     /// \warning the session becomes invalid after this call, its further external usage will
@@ -151,14 +191,38 @@ public:
     ///
     /// \threadsafe
     future<invoke_result>
-    invoke(encode_callback_t encode_callback);
+    invoke(encode_ref_t encode_callback);
+
+    /// Sends a batch of invocation events, creating a new channel for each of them.
+    ///
+    /// Spans are allocated as a contiguous range, all channels are registered in one step and all
+    /// the frames are handed to the transport back to back, so they are never interleaved with
+    /// other invocations.
+    ///
+    /// \returns a future for each invocation with the same guarantees as the single invoke gives.
+    ///
+    /// \threadsafe
+    std::vector<future<invoke_result>>
+    invoke(std::size_t size, batch_encode_ref_t encode_callback);
 
     /// TODO: Implement: invoke_mute - sends an invoke event without channel creation.
 
-    /// Sends an event without creating a new channel.
+    /// Sends an invocation event without creating a new channel.
+    ///
+    /// Invocation frames are never delayed behind bulk frames of other channels and keep their
+    /// order, which is required for channel ids to increase.
     future<void>
     push(io::encoder_t::message_type&& message);
 
+    /// Sends an event into the channel with the given span.
+    ///
+    /// Frames larger than 64 KiB are written one at a time. Smaller frames pushed meanwhile are
+    /// written between them unless their channel has bulk frames queued, so a large transfer
+    /// doesn't block small requests on the same connection for longer than a single bulk frame is
+    /// written. Split large payloads into several messages to bound this time.
+    future<void>
+    push(std::uint64_t span, io::encoder_t::message_type&& message);
+
     /*!
      * Unsubscribes a channel with the given span.
      *
@@ -181,6 +245,21 @@ private:
 
     void
     pull(std::shared_ptr<transport_type> transport);
+
+    /// Writes the frame immediately or queues it if a bulk frame is being written.
+    void
+    schedule(std::shared_ptr<push_t> pusher, bool urgent);
+
+    void
+    write(std::shared_ptr<push_t> pusher);
+
+    /// Called when a bulk frame is written, writes queued frames.
+    void
+    on_bulk(std::uint64_t span);
+
+    /// Accounts the given response latency sample.
+    void
+    observe(std::chrono::steady_clock::duration elapsed);
 };
 
 }} // namespace cocaine::framework
@@ -0,0 +1,97 @@
+/*
+    Copyright (c) 2015 Evgeny Safronov <division494@gmail.com>
+    Copyright (c) 2011-2015 Other contributors as noted in the AUTHORS file.
+    This file is part of Cocaine.
+    Cocaine is free software; you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+    Cocaine is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Lesser General Public License for more details.
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <random>
+
+#include "cocaine/framework/service/options.hpp"
+
+namespace cocaine { namespace framework { namespace detail {
+
+/// Exponential backoff with jitter.
+///
+/// The n-th delay is randomly chosen from `[d / 2, d]`, where `d = min(base * 2^n, cap)`.
+///
+/// \internal
+class backoff_t {
+    std::chrono::milliseconds base;
+    std::chrono::milliseconds cap;
+    std::uint32_t attempt;
+
+public:
+    backoff_t(std::chrono::milliseconds base, std::chrono::milliseconds cap);
+
+    /// Returns the next delay, advancing the attempt counter.
+    auto next(std::minstd_rand& random) -> std::chrono::milliseconds;
+
+    /// Returns the number of delays generated since the last reset.
+    auto attempts() const noexcept -> std::uint32_t;
+
+    void
+    reset() noexcept;
+};
+
+/// Circuit breaker guarding connection attempts to a single service.
+///
+/// \internal
+/// \threadsafe
+class circuit_breaker_t {
+public:
+    enum class state_t {
+        /// Connection attempts are allowed.
+        closed,
+        /// Connection attempts are rejected until the open period expires.
+        open,
+        /// A single probe attempt is in progress, others are rejected.
+        half_open
+    };
+
+private:
+    const std::size_t threshold;
+
+    state_t state_;
+    std::size_t failures;
+    backoff_t backoff;
+    std::chrono::steady_clock::time_point deadline;
+    std::minstd_rand random;
+
+    mutable std::mutex mutex;
+
+public:
+    explicit
+    circuit_breaker_t(const service_options_t& options);
+
+    auto state() const -> state_t;
+
+    /// Checks whether a connection attempt is allowed now.
+    ///
+    /// An open circuit whose period has expired becomes half-open and allows exactly one attempt,
+    /// whose result must be reported using either `success` or `failure`.
+    auto allow() -> bool;
+
+    void
+    success();
+
+    void
+    failure();
+};
+
+}}} // namespace cocaine::framework::detail
@@ -0,0 +1,65 @@
+/*
+    Copyright (c) 2015 Evgeny Safronov <division494@gmail.com>
+    Copyright (c) 2011-2015 Other contributors as noted in the AUTHORS file.
+    This file is part of Cocaine.
+    Cocaine is free software; you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+    Cocaine is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Lesser General Public License for more details.
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include <cocaine/hpack/header.hpp>
+
+namespace cocaine { namespace framework { namespace detail {
+
+/// Header marking messages whose single string argument is compressed.
+///
+/// \internal
+struct content_encoding {
+    static
+    auto
+    name() -> const hpack::header::data_t&;
+
+    /// The only supported encoding: zlib stream.
+    static
+    auto
+    deflate() -> const hpack::header::data_t&;
+};
+
+/// Checks whether the message with the given headers carries a compressed payload.
+///
+/// \internal
+auto compressed(const std::vector<hpack::header_t>& headers) -> bool;
+
+/// Compresses the given data using the given zlib compression level.
+///
+/// \internal
+auto deflate(const char* data, std::size_t size, int level) -> std::string;
+
+/// Maximum size of a decompressed payload by default, bounding the memory a small malicious frame
+/// can make the receiver allocate.
+///
+/// \internal
+const std::size_t INFLATE_LIMIT = 64 * 1024 * 1024;
+
+/// Decompresses the given zlib stream.
+///
+/// \throws std::runtime_error if the data is corrupted or the decompressed payload is larger than
+///     the given limit.
+/// \internal
+auto inflate(const char* data, std::size_t size, std::size_t limit = INFLATE_LIMIT) -> std::string;
+
+}}} // namespace cocaine::framework::detail
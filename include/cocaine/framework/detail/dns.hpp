@@ -0,0 +1,115 @@
+/*
+    Copyright (c) 2015 Evgeny Safronov <division494@gmail.com>
+    Copyright (c) 2011-2015 Other contributors as noted in the AUTHORS file.
+    This file is part of Cocaine.
+    Cocaine is free software; you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+    Cocaine is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Lesser General Public License for more details.
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include <boost/asio/ip/tcp.hpp>
+
+#include <asio/deadline_timer.hpp>
+#include <asio/ip/tcp.hpp>
+
+#include "cocaine/framework/forwards.hpp"
+
+#include "cocaine/framework/detail/breaker.hpp"
+#include "cocaine/framework/detail/forwards.hpp"
+
+namespace cocaine { namespace framework { namespace detail {
+
+/// Locator endpoints obtained by resolving host names.
+///
+/// All hosts are resolved concurrently on the given event loop, and then re-resolved periodically
+/// in the background. If resolving a host fails its previously resolved endpoints are kept. While
+/// no host has been resolved at all, rounds are retried with an exponential backoff instead of
+/// waiting for the whole period.
+///
+/// \internal
+/// \threadsafe
+class dns_resolver_t : public std::enable_shared_from_this<dns_resolver_t> {
+public:
+    typedef boost::asio::ip::tcp::endpoint endpoint_type;
+    typedef std::tuple<std::string, std::uint16_t> host_type;
+
+private:
+    loop_t& loop;
+    const std::vector<host_type> hosts;
+    const std::chrono::milliseconds interval;
+
+    /// Latest endpoints of each host in the order of hosts.
+    std::vector<std::vector<endpoint_type>> resolved;
+
+    /// Whether some round of resolving has produced endpoints.
+    bool ready;
+    bool stopped;
+
+    /// Lookups of the current round.
+    std::vector<std::shared_ptr<asio::ip::tcp::resolver>> lookups;
+    std::size_t pending;
+
+    asio::deadline_timer timer;
+
+    /// Delays between rounds without any endpoints.
+    backoff_t backoff;
+    std::minstd_rand random;
+
+    std::vector<task<std::vector<endpoint_type>>::promise_type> waiting;
+    mutable std::mutex mutex;
+
+public:
+    /// \param interval re-resolving period, zero disables re-resolving.
+    dns_resolver_t(std::vector<host_type> hosts, loop_t& loop, std::chrono::milliseconds interval);
+
+    /// Starts the first round of resolving.
+    void
+    start();
+
+    /// Cancels all pending lookups and stops re-resolving.
+    void
+    stop();
+
+    /// Returns currently known endpoints, which are empty until some round produces them.
+    auto current() const -> std::vector<endpoint_type>;
+
+    /// Returns endpoints once some round of resolving produces them.
+    ///
+    /// If the round in progress produces no endpoints, the future fails with `host_not_found`
+    /// error instead.
+    auto endpoints() -> task<std::vector<endpoint_type>>::future_type;
+
+private:
+    /// \pre mutex is locked.
+    void
+    resolve();
+
+    void
+    on_resolve(const std::error_code& ec, asio::ip::tcp::resolver::iterator it, std::size_t id);
+
+    void
+    on_timer(const std::error_code& ec);
+
+    /// \pre mutex is locked.
+    auto flatten() const -> std::vector<endpoint_type>;
+};
+
+}}} // namespace cocaine::framework::detail
@@ -0,0 +1,182 @@
+/*
+    Copyright (c) 2015 Evgeny Safronov <division494@gmail.com>
+    Copyright (c) 2011-2015 Other contributors as noted in the AUTHORS file.
+    This file is part of Cocaine.
+    Cocaine is free software; you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+    Cocaine is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Lesser General Public License for more details.
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "cocaine/framework/forwards.hpp"
+#include "cocaine/framework/service/options.hpp"
+#include "cocaine/framework/session.hpp"
+
+namespace cocaine { namespace framework { namespace detail {
+
+/// Set of sessions to the same service.
+///
+/// Depending on options the pool either keeps a fixed number of sessions, all connecting to the
+/// first reachable endpoint of the service, or keeps the same number of sessions to each resolved
+/// endpoint.
+///
+/// Sessions that failed to connect are excluded from routing for the quarantine period unless
+/// there are no other sessions left. The period grows exponentially with jitter on consecutive
+/// failures of the same session.
+///
+/// In spread mode the pool also maintains a consistent hash ring of the resolved endpoints, which
+/// is rebuilt each time the set of endpoints changes, to route invocations by a key.
+///
+/// \internal
+/// \threadsafe
+class session_pool_t : public std::enable_shared_from_this<session_pool_t> {
+public:
+    typedef session_t::endpoint_type endpoint_type;
+
+private:
+    class slot_t;
+
+    /// Ring point: the hash and the index of the endpoint it belongs to.
+    typedef std::pair<std::uint64_t, std::size_t> point_type;
+
+    scheduler_t& scheduler;
+    const service_options_t options;
+
+    bool assigned_;
+    bool hard_shutdown_;
+
+    /// In spread mode slots are grouped by endpoint: `options.pool` consecutive slots per each.
+    std::vector<std::shared_ptr<slot_t>> slots;
+
+    /// Consistent hash ring sorted by hash, empty unless in spread mode.
+    std::vector<point_type> ring;
+
+    std::size_t counter;
+    std::minstd_rand random;
+
+    mutable std::mutex mutex;
+
+public:
+    session_pool_t(service_options_t options, scheduler_t& scheduler);
+
+    ~session_pool_t();
+
+    /// Checks whether the service endpoints have been assigned at least once.
+    auto assigned() const -> bool;
+
+    /// Checks whether at least one pooled session is connected.
+    auto connected() const -> bool;
+
+    /// Updates the set of service endpoints.
+    ///
+    /// In spread mode sessions to the endpoints that are no longer present are dropped from the
+    /// pool, while sessions to new endpoints are created in disconnected state.
+    void
+    assign(const std::vector<endpoint_type>& endpoints);
+
+    /// Selects the session for the next invocation.
+    ///
+    /// The outstanding invocation counter of a session consists of the channels currently
+    /// registered in it plus invocations that have already selected it, but have not been sent
+    /// yet. The latter are accounted until the returned pointer (and all its copies) is destroyed,
+    /// so keep it alive until the invocation is sent.
+    ///
+    /// \returns none if there are no sessions in the pool.
+    auto select() -> std::shared_ptr<session_t>;
+
+    /// Selects the session for the invocation with the given routing key.
+    ///
+    /// In spread mode the key is mapped to an endpoint using consistent hashing with bounded
+    /// loads: the endpoint is the first one clockwise from the key hash on the ring whose
+    /// outstanding invocations do not exceed `options.bound` times the average. Thus the same key
+    /// goes to the same endpoint while it is alive and not overloaded, and only keys of added or
+    /// removed endpoints move when the set of endpoints changes. The least loaded session to the
+    /// selected endpoint is returned.
+    ///
+    /// Otherwise all sessions share the same endpoints, and the key is ignored.
+    ///
+    /// The returned pointer is accounted the same way as in `select`.
+    ///
+    /// \returns none if there are no sessions in the pool.
+    auto select(const std::string& key) -> std::shared_ptr<session_t>;
+
+    /// Selects a session to each endpoint, the least loaded one among sessions to the same
+    /// endpoint, for example to broadcast an invocation.
+    ///
+    /// In spread mode this gives a session per resolved endpoint. Otherwise all sessions share
+    /// the same endpoints, so a single connected session is selected along with the peer it's
+    /// connected to; nothing is selected if there are no connected sessions. The returned pointers
+    /// are accounted the same way as in `select`.
+    auto select_all() -> std::vector<std::pair<endpoint_type, std::shared_ptr<session_t>>>;
+
+    /// Selects the cheapest connected session other than the given one, for example to send a
+    /// hedged invocation.
+    ///
+    /// The returned pointer is accounted the same way as in `select`.
+    ///
+    /// \returns none if there are no such sessions.
+    auto select_other(const session_t* exclude) -> std::shared_ptr<session_t>;
+
+    /// Connects the given pooled session to its endpoints, quarantining it on failure.
+    ///
+    /// The quarantine backoff of the session is reset after a successful connection.
+    auto connect(std::shared_ptr<session_t> session) -> task<void>::future_type;
+
+    /// Returns the last connection error of the given pooled session if it's still quarantined.
+    ///
+    /// \returns null if the session is not quarantined or has been dropped from the pool.
+    auto quarantined(const session_t* session) const -> std::exception_ptr;
+
+    /// Sets the hard shutdown policy for all current and future pooled sessions.
+    void
+    hard_shutdown(bool policy);
+
+    /// Returns all pooled sessions.
+    auto sessions() const -> std::vector<std::shared_ptr<session_t>>;
+
+    /// Returns the number of outstanding invocations for each pooled session.
+    auto inflight() const -> std::vector<std::size_t>;
+
+private:
+    static
+    auto lease(std::shared_ptr<slot_t> slot) -> std::shared_ptr<session_t>;
+
+    /// \pre mutex is locked.
+    auto make_slot(std::vector<endpoint_type> endpoints) -> std::shared_ptr<slot_t>;
+
+    void
+    on_connect(task<void>::future_move_type future, std::shared_ptr<slot_t> slot);
+
+    /// \pre mutex is locked.
+    auto least_loaded(std::chrono::steady_clock::time_point now) -> std::shared_ptr<slot_t>;
+
+    /// \pre mutex is locked.
+    auto two_choices(std::chrono::steady_clock::time_point now) -> std::shared_ptr<slot_t>;
+
+    /// \pre mutex is locked.
+    auto consistent(const std::string& key, std::chrono::steady_clock::time_point now) -> std::shared_ptr<slot_t>;
+
+    /// \pre mutex is locked.
+    void
+    rebuild();
+};
+
+}}} // namespace cocaine::framework::detail
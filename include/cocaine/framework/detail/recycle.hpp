@@ -0,0 +1,82 @@
+/*
+    Copyright (c) 2015 Evgeny Safronov <division494@gmail.com>
+    Copyright (c) 2011-2015 Other contributors as noted in the AUTHORS file.
+    This file is part of Cocaine.
+    Cocaine is free software; you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+    Cocaine is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Lesser General Public License for more details.
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <new>
+
+namespace cocaine { namespace framework { namespace detail {
+
+/// Process-wide cache of memory blocks grouped by power-of-two size classes.
+///
+/// Objects allocated for each message sent, like write operations, have a few fixed sizes and
+/// short lifetimes, so released blocks are kept for reuse by the next messages instead of being
+/// returned to the heap. Blocks are usually allocated on the event loop thread and released on the
+/// user one or vice versa, so the cache is shared between threads rather than kept per thread.
+/// Blocks larger than the largest size class are not cached.
+///
+/// \threadsafe
+///
+/// \internal
+struct block_cache_t {
+    static
+    auto
+    allocate(std::size_t size) -> void*;
+
+    static
+    void
+    deallocate(void* block, std::size_t size) noexcept;
+};
+
+/// Allocator backed by the block cache, intended to be used with `std::allocate_shared`.
+///
+/// \internal
+template<class T>
+class recycling_allocator {
+public:
+    typedef T value_type;
+
+    recycling_allocator() noexcept {}
+
+    template<class U>
+    recycling_allocator(const recycling_allocator<U>&) noexcept {}
+
+    auto allocate(std::size_t n) -> T* {
+        return static_cast<T*>(block_cache_t::allocate(n * sizeof(T)));
+    }
+
+    void
+    deallocate(T* block, std::size_t n) noexcept {
+        block_cache_t::deallocate(block, n * sizeof(T));
+    }
+};
+
+template<class T, class U>
+inline
+bool
+operator==(const recycling_allocator<T>&, const recycling_allocator<U>&) noexcept {
+    return true;
+}
+
+template<class T, class U>
+inline
+bool
+operator!=(const recycling_allocator<T>&, const recycling_allocator<U>&) noexcept {
+    return false;
+}
+
+}}} // namespace cocaine::framework::detail
@@ -16,11 +16,23 @@
 
 #pragma once
 
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <random>
 #include <unordered_map>
 
 #include <boost/asio/ip/tcp.hpp>
 
+#include <cocaine/idl/locator.hpp>
+
+#include "cocaine/framework/encoder.hpp"
 #include "cocaine/framework/forwards.hpp"
+#include "cocaine/framework/service/options.hpp"
+
+#include "cocaine/framework/detail/breaker.hpp"
+#include "cocaine/framework/detail/dns.hpp"
 
 namespace cocaine {
 
@@ -28,8 +40,17 @@ namespace framework {
 
 namespace detail {
 
+class snapshot_writer_t;
+
 /*!
- * \reentrant
+ * Resolves services through a single long-lived Locator session.
+ *
+ * The latency and errors of each Locator are tracked, so the session connects to the best one.
+ * After a network error or timeout the session is abandoned, and the next resolve connects to the
+ * next best Locator. Several resolvers may share the session along with the statistics, which is
+ * closed when the last of them is destroyed.
+ *
+ * \threadsafe
  */
 class resolver_t {
 public:
@@ -40,45 +61,230 @@ public:
         unsigned int version;
     };
 
+    /// \internal
+    class locators_t;
+
 private:
     scheduler_t& scheduler;
     std::vector<endpoint_type> endpoints_;
 
+    /// Resolves Locator host names if set, taking precedence over `endpoints_`.
+    std::shared_ptr<dns_resolver_t> hosts;
+
+    const std::chrono::milliseconds timeout;
+
+    /// The Locator session along with per-Locator statistics, shared with pending resolves and
+    /// possibly with other resolvers.
+    std::shared_ptr<locators_t> locators;
+
 public:
     /*!
      * \note sets default endpoint to [::]:10053.
+     *
+     * \param timeout time after which a resolve fails with `timed_out` error, zero disables it.
+     * \param locators the Locator session of another resolver to share, see \sa shared, if null
+     *     the resolver creates its own one.
      */
-    explicit resolver_t(scheduler_t& scheduler);
+    explicit resolver_t(scheduler_t& scheduler,
+                        std::chrono::milliseconds timeout = std::chrono::milliseconds(0),
+                        std::shared_ptr<locators_t> locators = nullptr);
 
-    ~resolver_t();
+    /// Returns the Locator session of this resolver to be shared with other ones.
+    auto shared() const -> std::shared_ptr<locators_t>;
 
     std::vector<endpoint_type> endpoints() const;
+
+    /// \warning must be called before the first resolve.
     void endpoints(std::vector<endpoint_type> endpoints);
 
+    /// Makes the resolver to connect to the Locator endpoints resolved from host names.
+    ///
+    /// \warning must be called before the first resolve.
+    void endpoints(std::shared_ptr<dns_resolver_t> hosts);
+
     // No queue.
     auto resolve(std::string name) -> task<result_t>::future_type;
+
+    /// Resolves the service using the already encoded request.
+    auto resolve(std::string name, std::shared_ptr<const prepared<io::locator::resolve>> request) ->
+        task<result_t>::future_type;
+
+    /// Subscribes to the service announcements of the Locator under the given id.
+    ///
+    /// The Locator streams a full dump of its services each time any of them changes.
+    auto subscribe(std::string uuid) -> task<channel<io::locator::connect>>::future_type;
+
+private:
+    /// Connects the given Locator session to the best reachable Locator, waiting for endpoints to
+    /// be resolved if required.
+    auto connect(std::shared_ptr<session_t> locator) -> task<void>::future_type;
 };
 
 /// Manages with queue.
+///
+/// Concurrent resolves of the same service are joined. Results are optionally cached for the
+/// configured time, after which they are still returned for the stale period while being refreshed
+/// in the background. Services not found by the Locator are optionally cached as well, so their
+/// resolves fail fast for a growing period.
+///
 /// \threadsafe
 class serialized_resolver_t : public std::enable_shared_from_this<serialized_resolver_t> {
 public:
     typedef resolver_t::result_t result_type;
     typedef resolver_t::endpoint_type endpoint_type;
 
+    /// Called with the new result of a service each time its announced endpoints change.
+    typedef std::function<void(const std::string& name, const result_type& result)> update_handler_t;
+
 private:
+    struct cached_t {
+        result_type result;
+        std::chrono::steady_clock::time_point birth;
+    };
+
+    struct subscriber_t {
+        std::uint64_t id;
+        update_handler_t handler;
+    };
+
+    /// Negative cache entry of a service that the Locator has not found.
+    struct missing_t {
+        backoff_t backoff;
+        std::chrono::steady_clock::time_point until;
+
+        /// Number of resolves failed locally.
+        std::uint64_t suppressed;
+    };
+
     resolver_t resolver;
     scheduler_t& scheduler;
+    const resolve_options_t options;
     std::unordered_map<std::string, std::deque<task<result_type>::promise_type>> inprogress;
-    std::mutex mutex;
+    std::unordered_map<std::string, cached_t> cache;
+    std::unordered_map<std::string, missing_t> missing;
+    std::minstd_rand random;
+
+    /// Resolve requests are encoded once per service name, since they are sent on each reconnect.
+    std::unordered_map<std::string, std::shared_ptr<const prepared<io::locator::resolve>>> requests;
+
+    /// Last resolved or announced result of each service, used to detect announced changes.
+    std::unordered_map<std::string, result_type> latest;
+
+    /// Prefetched results, each one is returned by the next resolve of the service.
+    std::unordered_map<std::string, result_type> prefetched;
+
+    /// Results loaded from the snapshot, each one is returned by the next resolve of the service
+    /// while it's being revalidated in the background.
+    std::unordered_map<std::string, result_type> provisional;
+
+    /// Writes the snapshot file in the background, null if persisting is disabled.
+    std::shared_ptr<snapshot_writer_t> writer;
+
+    /// Services sharing this resolver subscribe separately, possibly for different versions.
+    std::unordered_multimap<std::string, subscriber_t> handlers;
+
+    /// Id of the next subscription.
+    std::uint64_t subscribers;
+    bool watching;
+    mutable std::mutex mutex;
 
 public:
-    serialized_resolver_t(std::vector<endpoint_type> endpoints, scheduler_t& scheduler);
+    /// \param locators the Locator session to share, see \sa resolver_t::shared.
+    serialized_resolver_t(std::vector<endpoint_type> endpoints,
+                          scheduler_t& scheduler,
+                          resolve_options_t options = resolve_options_t(),
+                          std::shared_ptr<resolver_t::locators_t> locators = nullptr);
+
+    serialized_resolver_t(std::shared_ptr<dns_resolver_t> hosts,
+                          scheduler_t& scheduler,
+                          resolve_options_t options = resolve_options_t(),
+                          std::shared_ptr<resolver_t::locators_t> locators = nullptr);
+
+    /// Returns the Locator session of this resolver to be shared with other ones.
+    auto shared() const -> std::shared_ptr<resolver_t::locators_t>;
 
     auto resolve(std::string name) -> task<result_type>::future_type;
 
-    result_type
-    notify_all(task<result_type>::future_move_type future, std::string name);
+    /// Drops the cached result for the given service, for example after failing to connect to
+    /// its endpoints.
+    void
+    invalidate(const std::string& name);
+
+    /// Returns the number of resolves of the given service failed locally, because the Locator
+    /// has recently not found it.
+    auto suppressed(const std::string& name) const -> std::uint64_t;
+
+    /// Resolves the given services concurrently over the single Locator session.
+    ///
+    /// Each result is returned by the next resolve of its service without asking the Locator,
+    /// even if caching is disabled.
+    ///
+    /// \returns a future which is set after all services are resolved, or holds the first error.
+    auto prefetch(const std::vector<std::string>& names) -> task<void>::future_type;
+
+    /// Stores the prefetched result of the given service.
+    void
+    preload(const std::string& name, result_type result);
+
+    /// Subscribes to the result changes of the given service.
+    ///
+    /// The handler is notified when a result loaded from the snapshot turns out to be outdated.
+    /// If enabled by options, the resolver also subscribes to the Locator announcements, so
+    /// services resolved through it get their cached results refreshed as soon as the Locator
+    /// announces new endpoints. The announcement subscription is started once and restarted
+    /// after a short delay if it breaks, until the resolver is destroyed.
+    ///
+    /// \returns the subscription id to unsubscribe with.
+    auto subscribe(const std::string& name, update_handler_t handler) -> std::uint64_t;
+
+    /// Removes the handler registered by the given subscription of the service.
+    ///
+    /// Notifications already scheduled may still be delivered.
+    void
+    unsubscribe(const std::string& name, std::uint64_t id);
+
+    /// Loads provisional results from the given snapshot file and keeps the file up to date with
+    /// the latest results.
+    ///
+    /// A missing or malformed snapshot is ignored. Must be called before the first resolve.
+    void
+    persist(std::string path);
+
+    /// Starts the subscription after the given delay.
+    void
+    watch(std::chrono::milliseconds delay);
+
+    /// Applies the announced result of a service.
+    ///
+    /// Services that have never been resolved through this resolver are ignored.
+    void
+    announce(const std::string& name, result_type result);
+
+    /// Completes the resolve of the given service, retrying it with another Locator on network
+    /// errors while there are retries left.
+    auto notify_all(task<result_type>::future_move_type future, std::string name, std::size_t retries) ->
+        task<result_type>::future_type;
+
+private:
+    /// Starts resolving the service.
+    ///
+    /// \pre mutex is locked and there is no resolve of this service in progress.
+    auto start(const std::string& name) -> task<result_type>::future_type;
+
+    /// \pre mutex is locked.
+    auto attempt(const std::string& name, std::size_t retries) -> task<result_type>::future_type;
+
+    /// Schedules notification of the given service subscribers.
+    ///
+    /// \pre mutex is locked.
+    void
+    notify(const std::string& name, const result_type& result);
+
+    /// Submits the latest results for rewriting the snapshot file, if persisting is enabled.
+    ///
+    /// \pre mutex is locked.
+    void
+    save();
 };
 
 } // namespace detail
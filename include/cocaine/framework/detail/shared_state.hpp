@@ -46,7 +46,14 @@ public:
     shared_state_t() :
         trace(trace_t::current())
     {}
+    /// Pushes the next message into the channel, it is silently dropped if the channel has been
+    /// revoked.
     void put(value_type&& message);
+
+    /// Breaks the state with the given error.
+    ///
+    /// Errors arriving after the channel has been revoked are dropped, as well as the revocation
+    /// of an already broken channel.
     void put(const std::error_code& ec);
     auto get() -> task<value_type>::future_type;
 
@@ -0,0 +1,89 @@
+/*
+    Copyright (c) 2015 Evgeny Safronov <division494@gmail.com>
+    Copyright (c) 2011-2015 Other contributors as noted in the AUTHORS file.
+    This file is part of Cocaine.
+    Cocaine is free software; you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+    Cocaine is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Lesser General Public License for more details.
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include <boost/thread/thread.hpp>
+
+#include "cocaine/framework/detail/resolver.hpp"
+
+namespace cocaine { namespace framework { namespace detail {
+
+/// Resolve results keyed by service name.
+typedef std::unordered_map<std::string, resolver_t::result_t> snapshot_t;
+
+/// Reads the snapshot of resolve results from the given file through a read-only memory mapping.
+///
+/// \returns an empty snapshot if there is no such file.
+/// \throws std::runtime_error if the file is malformed or can't be read.
+/// \internal
+auto read_snapshot(const std::string& path) -> snapshot_t;
+
+/// Atomically replaces the given file with the snapshot of the given resolve results.
+///
+/// \throws std::runtime_error on I/O errors or if a service name or an endpoint list doesn't fit
+///     the snapshot format.
+/// \internal
+void
+write_snapshot(const std::string& path, const snapshot_t& snapshot);
+
+/// Writes snapshots to the given file on its own thread, keeping the event loop free of disk I/O.
+///
+/// Snapshots are written in the order they are submitted. Each submitted snapshot gets the next
+/// version, and a snapshot replaced by a newer one before being written is skipped, so frequent
+/// changes are coalesced into a single write and an older snapshot never overwrites a newer one.
+///
+/// \internal
+/// \threadsafe
+class snapshot_writer_t {
+    const std::string path;
+
+    /// The latest submitted snapshot and its version.
+    snapshot_t pending;
+    std::uint64_t version;
+
+    /// Version of the last written snapshot.
+    std::uint64_t written;
+
+    bool stopped;
+    std::mutex mutex;
+    std::condition_variable cv;
+    boost::thread thread;
+
+public:
+    explicit
+    snapshot_writer_t(std::string path);
+
+    /// Writes the latest submitted snapshot if it hasn't been written yet and stops the thread.
+    ~snapshot_writer_t();
+
+    /// Submits the snapshot for writing, replacing the pending one.
+    ///
+    /// \returns the version of the submitted snapshot.
+    auto write(snapshot_t snapshot) -> std::uint64_t;
+
+private:
+    void
+    run();
+};
+
+}}} // namespace cocaine::framework::detail
@@ -94,6 +94,12 @@ public:
     future<void>
     push(io::encoder_t::message_type&& message);
 
+    /// Sends an event into the channel with the given span.
+    ///
+    /// All frames are written in the order they are pushed.
+    future<void>
+    push(std::uint64_t span, io::encoder_t::message_type&& message);
+
     void
     revoke(std::uint64_t span);
 
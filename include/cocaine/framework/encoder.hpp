@@ -20,12 +20,69 @@
 
 #pragma once
 
+#include <functional>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <boost/mpl/front.hpp>
+#include <boost/mpl/size.hpp>
+
+#include <asio/buffer.hpp>
+
 #include <cocaine/rpc/asio/encoder.hpp>
+#include <cocaine/utility.hpp>
 
 namespace cocaine { namespace framework {
 
+/// Non-owning reference to a callable object.
+///
+/// Unlike std::function it neither copies nor allocates, so it must be called only while the
+/// referenced object is alive. Encode callbacks are called synchronously during the invocation,
+/// which allows to encode arguments in place without binding their copies.
+template<class Signature>
+class callback_ref;
+
+template<class R, class... Args>
+class callback_ref<R(Args...)> {
+    void* object;
+    R(*fn)(void*, Args...);
+
+public:
+    template<
+        class F,
+        class = typename std::enable_if<!std::is_same<typename std::decay<F>::type, callback_ref>::value>::type
+    >
+    callback_ref(F& f) noexcept :
+        object(static_cast<void*>(&f)),
+        fn(&callback_ref::call<F>)
+    {}
+
+    R operator()(Args... args) const {
+        return fn(object, std::forward<Args>(args)...);
+    }
+
+private:
+    template<class F>
+    static
+    R
+    call(void* object, Args... args) {
+        return (*static_cast<F*>(object))(std::forward<Args>(args)...);
+    }
+};
+
 typedef std::function<io::encoder_t::message_type(std::uint64_t)> encode_callback_t;
 
+/// Encodes the invocation with the given index in a batch using the given span.
+typedef std::function<io::encoder_t::message_type(std::uint64_t, std::size_t)> batch_encode_callback_t;
+
+/// Non-owning counterparts of the encode callbacks, used by sessions to encode invocations in
+/// place.
+typedef callback_ref<io::encoder_t::message_type(std::uint64_t)> encode_ref_t;
+typedef callback_ref<io::encoder_t::message_type(std::uint64_t, std::size_t)> batch_encode_ref_t;
+
 template<class Event, class... Args>
 static
 io::encoder_t::message_type
@@ -33,4 +90,145 @@ encode(std::uint64_t span, Args&... args) {
     return io::encoded<Event>(span, std::forward<Args>(args)...);
 }
 
+namespace detail {
+
+template<class Event, class Tuple, std::size_t... Index>
+inline
+io::encoder_t::message_type
+encode_tuple(std::uint64_t span, const Tuple& args, index_sequence<Index...>) {
+    return io::encoded<Event>(span, std::get<Index>(args)...);
+}
+
+} // namespace detail
+
+/// List of user memory chunks, which are sent as a single string argument.
+///
+/// The chunks are referenced only while the message is being encoded, i.e. they may be released
+/// right after the send method returns.
+typedef std::vector<asio::const_buffer> buffers_t;
+
+/// Encodes the event with a single string argument, gathering its bytes from the given chunks.
+///
+/// Unlike concatenating the chunks into a temporary string and encoding it, the chunks are copied
+/// directly into the message buffer after the envelope, once. This is not zero-copy: the transport
+/// writer owns the encoded messages it queues, so the chunks can't be written in place without
+/// keeping them alive until the write completes.
+template<class Event>
+struct gathered : public io::encoder_t::message_type {
+    typedef typename io::event_traits<Event>::argument_type argument_type;
+
+    static_assert(boost::mpl::size<argument_type>::value == 1 &&
+        std::is_same<typename boost::mpl::front<argument_type>::type, std::string>::value,
+        "only events with a single string argument can be gathered"
+    );
+
+    gathered(std::uint64_t span, const buffers_t& buffers) {
+        std::size_t size = 0;
+        for (const auto& chunk : buffers) {
+            size += asio::buffer_size(chunk);
+        }
+
+        msgpack::packer<buffer_type> packer(buffer);
+        packer.pack_array(3);
+        packer.pack(span);
+        packer.pack(static_cast<int>(io::event_traits<Event>::id));
+        packer.pack_array(1);
+        packer.pack_raw(size);
+
+        for (const auto& chunk : buffers) {
+            packer.pack_raw_body(asio::buffer_cast<const char*>(chunk), asio::buffer_size(chunk));
+        }
+    }
+};
+
+/// Event encoded once, which can be sent any number of times through different channels.
+///
+/// The arguments are packed at construction, so sending it only writes the envelope with the
+/// given span followed by the pre-encoded payload. Useful for hot paths invoking the same event
+/// with the same arguments over and over again, pass it instead of arguments to invoke or send
+/// the event.
+///
+/// For example:
+/// \code{.cpp}
+/// const prepared<io::storage::read> read("collection", "key");
+/// auto future = storage.invoke<io::storage::read>(read);
+/// \endcode
+template<class Event>
+class prepared {
+    /// Encoded event id followed by the encoded arguments.
+    std::string payload;
+
+public:
+    template<class... Args>
+    explicit
+    prepared(const Args&... args) {
+        // An encoded message starts with the fixed array header and the span, which takes a
+        // single byte when it's zero, the rest is the payload.
+        const io::encoded<Event> message(0, args...);
+        payload.assign(message.data() + 2, message.size() - 2);
+    }
+
+    /// Returns the message with the given span.
+    auto encode(std::uint64_t span) const -> io::encoder_t::message_type;
+};
+
+namespace detail {
+
+/// Writes the envelope with the given span followed by the pre-encoded payload.
+///
+/// \internal
+struct patched : public io::encoder_t::message_type {
+    patched(std::uint64_t span, const std::string& payload) {
+        msgpack::packer<buffer_type> packer(buffer);
+        packer.pack_array(3);
+        packer.pack(span);
+        buffer.write(payload.data(), payload.size());
+    }
+};
+
+/// Encodes the event either from its arguments or from the prepared one.
+///
+/// \internal
+template<class Event, class... Args>
+inline
+io::encoder_t::message_type
+encode_args(std::uint64_t span, const Args&... args) {
+    return io::encoded<Event>(span, args...);
+}
+
+/// \internal
+template<class Event>
+inline
+io::encoder_t::message_type
+encode_args(std::uint64_t span, const prepared<Event>& event) {
+    return event.encode(span);
+}
+
+} // namespace detail
+
+namespace detail {
+
+/// Encodes the event with a single string argument compressed using the given zlib level,
+/// marking it with the content encoding header.
+///
+/// Compressed payloads are transparently decompressed by the receiving side decoder.
+///
+/// \internal
+io::encoder_t::message_type
+deflated(std::uint64_t span, int id, const char* data, std::size_t size, int level);
+
+} // namespace detail
+
+template<class Event>
+auto prepared<Event>::encode(std::uint64_t span) const -> io::encoder_t::message_type {
+    return detail::patched(span, payload);
+}
+
+template<class Event, class... Args>
+static
+io::encoder_t::message_type
+encode_batch(std::uint64_t span, std::size_t id, const std::vector<std::tuple<Args...>>& batch) {
+    return detail::encode_tuple<Event>(span, batch[id], typename make_index_sequence<sizeof...(Args)>::type());
+}
+
 }}
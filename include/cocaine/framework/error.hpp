@@ -35,7 +35,9 @@ enum service_errors {
     /// The specified service is not available.
     service_not_found = 1,
     /// The service provides API with version different than required.
-    version_mismatch
+    version_mismatch,
+    /// The service is temporarily unavailable, because of repeated connection failures.
+    service_unavailable
 };
 
 /// Response specific error codes.
@@ -114,6 +116,24 @@ public:
     const std::string& name() const noexcept;
 };
 
+/*!
+ * The exception class, that is thrown by the Framework when it refuses to connect to the service
+ * after repeated connection failures until the backoff period expires.
+ *
+ * You can always obtain service's name by calling the corresponding method.
+ */
+class service_unavailable : public error_t {
+    std::string name_;
+
+public:
+    explicit service_unavailable(const std::string& name);
+
+    ~service_unavailable() noexcept;
+
+    /// Returns service's name, which is unavailable.
+    const std::string& name() const noexcept;
+};
+
 /*!
  * The exception class, that is thrown by the Framework when it detects protocol version mismatch.
  */
@@ -47,12 +47,18 @@ namespace cocaine {
         template<class Session>
         class basic_receiver_t;
 
+        template<class Session>
+        class basic_pipeline_t;
+
         template<class T, class Session>
         class sender;
 
         template<class T, class Session>
         class receiver;
 
+        template<class T, class Session>
+        class pipelined_sender;
+
         class basic_session_t;
 
         template<class Event>
@@ -63,6 +69,10 @@ namespace cocaine {
 
         typedef session<basic_session_t> session_t;
 
+        namespace detail {
+            class serialized_resolver_t;
+        } // namespace detail
+
         class basic_service_t;
 
         template<class T>
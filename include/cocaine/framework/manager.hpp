@@ -21,6 +21,7 @@
 #include <string>
 
 #include "cocaine/framework/forwards.hpp"
+#include "cocaine/framework/service/options.hpp"
 #include "cocaine/framework/session.hpp"
 
 namespace cocaine { namespace io {
@@ -30,6 +31,13 @@ namespace cocaine { namespace io {
 namespace cocaine { namespace framework {
 
 class service_manager_data;
+
+/// Owns the event loop threads and creates service clients.
+///
+/// Service clients created with default settings are registered by their name and protocol
+/// version, so the subsequent requests for the same service return handles sharing already
+/// established sessions and resolved endpoints instead of creating new ones. Registered services
+/// live as long as the manager does and are resolved through a single Locator connection.
 class service_manager_t {
 public:
     typedef session_t::endpoint_type endpoint_type;
@@ -48,8 +56,11 @@ public:
     /// Constructs a service manager using the given entry points and number of worker threads.
     service_manager_t(std::vector<endpoint_type> entries, unsigned int threads);
 
-    /// Constructs a new service manager after performing a blocking DNS resolving of a given
-    /// locator endpoints.
+    /// Constructs a service manager using the given locator host names.
+    ///
+    /// Host names are resolved asynchronously and concurrently on the manager's event loop, so
+    /// the construction doesn't block. Connecting to the Locator waits for the first round to
+    /// complete. Host names are resolved again every minute to pick up DNS changes.
     ///
     /// \param entries locator endpoints as a list of FQDN:port pairs.
     /// \param threads number of worker threads.
@@ -57,15 +68,58 @@ public:
 
     ~service_manager_t();
 
+    /// Returns the Locator endpoints.
+    ///
+    /// \note if the manager has been constructed with host names the result is empty until they
+    /// are resolved.
     std::vector<endpoint_type>
     endpoints() const;
 
+    /// Returns a handle to the shared service client, creating it on the first request.
+    ///
+    /// \note the handles share connections, so changing the hard shutdown policy of one affects
+    /// all others.
     template<class T>
     service<T>
     create(std::string name) {
-        return service<T>(logger(), std::move(name), endpoints(), next());
+        return service<T>(*shared(std::move(name), io::protocol<T>::version::value));
     }
 
+    /// Creates a dedicated service client using the given settings.
+    ///
+    /// Such clients are not registered, i.e. each call establishes its own connections.
+    template<class T>
+    service<T>
+    create(std::string name, service_options_t options) {
+        return service<T>(*dedicated(std::move(name), io::protocol<T>::version::value, std::move(options)));
+    }
+
+    /// Resolves the given services concurrently over a single Locator connection.
+    ///
+    /// Call this at startup to avoid resolving the services one by one on their first use. The
+    /// results are consumed by the first connection of services created with \sa create(name).
+    ///
+    /// \returns a future which is set after all services are resolved, or holds the first error.
+    future<void>
+    prefetch(const std::vector<std::string>& names);
+
+    /// Sets resolve options of services created with \sa create(name), e.g. to cache resolved
+    /// endpoints or to watch the Locator announcements.
+    ///
+    /// \warning must be called before creating services, persisting or prefetching them.
+    void
+    resolve_options(resolve_options_t options);
+
+    /// Persists resolved endpoints of services created with \sa create(name) in the given file.
+    ///
+    /// Endpoints stored by a previous run are used for the first connection of each service, while
+    /// being revalidated through the Locator in the background. This lets restarted processes
+    /// connect immediately instead of resolving all services at once.
+    ///
+    /// \warning must be called before creating services.
+    void
+    persist(const std::string& path);
+
     /// Returns a shared pointer to the associated logger service.
     std::shared_ptr<service<io::log_tag>>
     logger() const;
@@ -76,6 +130,15 @@ private:
 
     scheduler_t&
     next();
+
+    /// Returns the registered service client with the given name and protocol version, creating
+    /// and registering a new one if there is no such service yet.
+    std::shared_ptr<basic_service_t>
+    shared(std::string name, uint version);
+
+    /// Creates a new unregistered service client with its own resolver.
+    std::shared_ptr<basic_service_t>
+    dedicated(std::string name, uint version, service_options_t options);
 };
 
 }} // namespace cocaine::framework
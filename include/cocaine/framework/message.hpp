@@ -46,6 +46,16 @@ public:
     /// undefined.
     decoded_message(msgpack::object, std::vector<char>&& storage, std::vector<hpack::header_t> headers);
 
+    /// Constructs a message object from msgpack object, which data is stored in 'storage' buffer,
+    /// and header vector, which data is owned by the separate 'origin' buffer.
+    ///
+    /// Used for messages, whose payload is decoded into another buffer than the received one, like
+    /// decompressed messages.
+    decoded_message(msgpack::object,
+                    std::vector<char>&& storage,
+                    std::vector<char>&& origin,
+                    std::vector<hpack::header_t> headers);
+
     ~decoded_message();
 
     // TODO: Noexcept?
@@ -58,6 +58,13 @@ public:
     /// This future may throw std::system_error on any network failure.
     auto recv() -> task<decoded_message>::future_type;
     cocaine::trace_t get_trace() const;
+
+    /// Revokes the channel without waiting for its completion.
+    ///
+    /// Pending and further receive operations fail with `operation_canceled` error, messages
+    /// arriving after this call are dropped.
+    void
+    revoke();
 };
 
 /// The receiver class provides a convenient way to extract typed messages from the session.
@@ -128,6 +135,21 @@ public:
             .then(trace_t::bind(&receiver::convert, std::placeholders::_1, d));
     }
 
+    /// Returns a function object, which revokes the channel if it is still alive.
+    ///
+    /// Unlike the receiver itself the function remains valid after recv() call, allowing to
+    /// cancel the pending receive operation.
+    auto revoker() const -> std::function<void()> {
+        BOOST_ASSERT(this->d);
+
+        std::weak_ptr<basic_receiver_t<session_type>> weak(d);
+        return [weak] {
+            if (auto d = weak.lock()) {
+                d->revoke();
+            }
+        };
+    }
+
 private:
     static inline
     typename from_receiver<T, Session>::result_type
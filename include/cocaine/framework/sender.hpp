@@ -16,13 +16,23 @@
 
 #pragma once
 
+#include <algorithm>
+#include <cstddef>
 #include <cstdint>
+#include <deque>
+#include <exception>
 #include <memory>
+#include <mutex>
+#include <string>
+#include <system_error>
+#include <vector>
 
 #include "cocaine/framework/encoder.hpp"
 #include "cocaine/framework/forwards.hpp"
 
+#include <cocaine/idl/streaming.hpp>
 #include <cocaine/rpc/asio/encoder.hpp>
+#include <cocaine/traits/error_code.hpp>
 
 #include <cocaine/trace/trace.hpp>
 
@@ -31,16 +41,40 @@ namespace cocaine {
 
 namespace framework {
 
+/// Settings of string payload compression.
+///
+/// Compressed messages are marked with a header, which is recognized by receivers built on this
+/// framework, so both sides of the channel must be.
+struct compression_t {
+    /// Minimum payload size to be compressed in bytes. Zero disables compression.
+    std::size_t threshold;
+
+    /// Zlib compression level from 1 (fastest) to 9 (best compression).
+    int level;
+
+    compression_t() :
+        threshold(0),
+        level(1)
+    {}
+};
+
 template<class Session>
 class basic_sender_t {
     typedef Session session_type;
 
     std::uint64_t id;
     std::shared_ptr<session_type> session;
+    compression_t compression;
 
 public:
     basic_sender_t(std::uint64_t id, std::shared_ptr<session_type> session);
 
+    /// Sets compression settings of the payloads sent via \sa write.
+    ///
+    /// \warning shouldn't be called concurrently with sending.
+    void
+    compress(compression_t compression);
+
     /*!
      * Pack given args in the message and push it through a session pointer.
      *
@@ -58,13 +92,159 @@ public:
     template<class Event, class... Args>
     auto
     send(Args&&... args) -> task<void>::future_type {
-        return send(io::encoded<Event>(id, std::forward<Args>(args)...));
+        return send(detail::encode_args<Event>(id, args...));
+    }
+
+    /// Sends the event with a single string argument, gathering it from the given chunks without
+    /// concatenating them first.
+    ///
+    /// \sa gathered.
+    template<class Event>
+    auto
+    gather(const buffers_t& buffers) -> task<void>::future_type {
+        return send(gathered<Event>(id, buffers));
+    }
+
+    /// Sends the event with a single string argument, compressing it according to the compression
+    /// settings.
+    template<class Event>
+    auto
+    write(const std::string& data) -> task<void>::future_type {
+        return send(encode_data<Event>(data.data(), data.size()));
     }
 
 private:
+    template<class> friend class basic_pipeline_t;
+
+    template<class Event>
+    auto
+    encode_data(const char* data, std::size_t size) const -> io::encoder_t::message_type {
+        if (compression.threshold != 0 && size >= compression.threshold) {
+            return detail::deflated(id, io::event_traits<Event>::id, data, size, compression.level);
+        }
+
+        const buffers_t buffers{{ asio::buffer(data, size) }};
+        return gathered<Event>(id, buffers);
+    }
+
     auto send(io::encoder_t::message_type&& message) -> task<void>::future_type;
 };
 
+/// Limits of the pipelined sending window.
+struct window_t {
+    /// Maximum number of messages being written at the same time.
+    std::size_t chunks;
+
+    /// Maximum total size of messages being written at the same time in bytes.
+    ///
+    /// A single message larger than this limit is still written, but alone.
+    std::size_t bytes;
+
+    /// Maximum payload size of a single chunk in bytes, larger payloads written through the
+    /// pipeline are split into several consecutive chunks.
+    ///
+    /// Bounds the time a single large chunk occupies the connection, so that small messages of
+    /// other channels are written in between. Defaults to 64 KiB, zero disables splitting.
+    std::size_t slice;
+
+    window_t() :
+        chunks(16),
+        bytes(1024 * 1024),
+        slice(64 * 1024)
+    {}
+};
+
+/// The basic pipeline writes messages into the channel without waiting for previous writes to
+/// complete, while keeping the number and the total size of messages in flight within the window.
+///
+/// Messages are written in the order they are pushed. Messages exceeding the window are queued
+/// until previous writes complete.
+///
+/// \threadsafe
+template<class Session>
+class basic_pipeline_t : public std::enable_shared_from_this<basic_pipeline_t<Session>> {
+    typedef Session session_type;
+
+    struct pending_t {
+        io::encoder_t::message_type message;
+        task<void>::promise_type promise;
+    };
+
+    std::shared_ptr<basic_sender_t<session_type>> sender;
+    const window_t window;
+
+    /// Number and total size of messages being written.
+    std::size_t chunks;
+    std::size_t bytes;
+
+    std::deque<pending_t> queue;
+    std::vector<task<void>::promise_type> flushes;
+
+    /// The first write error, after which the pipeline is broken.
+    std::exception_ptr error;
+
+    std::mutex mutex;
+
+public:
+    /// \throws std::invalid_argument if either the number or the total size limit of the window is
+    /// zero, since nothing could be ever written then.
+    basic_pipeline_t(std::shared_ptr<basic_sender_t<session_type>> sender, window_t window);
+
+    /// Pack given args in the message and push it into the pipeline.
+    template<class Event, class... Args>
+    auto
+    push(Args&&... args) -> task<void>::future_type {
+        return push(detail::encode_args<Event>(sender->id, args...));
+    }
+
+    /// Gathers the event argument from the given chunks and pushes it into the pipeline.
+    template<class Event>
+    auto
+    gather(const buffers_t& buffers) -> task<void>::future_type {
+        return push(gathered<Event>(sender->id, buffers));
+    }
+
+    /// Pushes the given payload as a sequence of events, each carrying at most the window slice
+    /// bytes of it.
+    ///
+    /// Each slice is compressed according to the sender compression settings.
+    ///
+    /// \returns a future of the last pushed event.
+    template<class Event>
+    auto
+    slice(const std::string& data) -> task<void>::future_type {
+        if (window.slice == 0 || data.size() <= window.slice) {
+            return push(sender->template encode_data<Event>(data.data(), data.size()));
+        }
+
+        task<void>::future_type future;
+        for (std::size_t offset = 0; offset < data.size(); offset += window.slice) {
+            const auto size = std::min(window.slice, data.size() - offset);
+            future = push(sender->template encode_data<Event>(data.data() + offset, size));
+        }
+
+        return future;
+    }
+
+    /// Pushes the message into the pipeline.
+    ///
+    /// \returns a future, which is set when the message is handed to the session, i.e. when there
+    /// is room for it in the window. Waiting for it before pushing the next message applies
+    /// backpressure. The future throws if the pipeline is broken by a previous write error.
+    auto push(io::encoder_t::message_type&& message) -> task<void>::future_type;
+
+    /// Returns a future, which is set when all messages pushed so far are written, or throws the
+    /// first write error occurred.
+    auto flush() -> task<void>::future_type;
+
+private:
+    /// \pre mutex is locked.
+    auto fits(std::size_t size) const -> bool;
+
+    void
+    on_write(task<void>::future_move_type future, std::size_t size);
+};
+
 template<class T, class Session>
 class sender {
 public:
@@ -90,6 +270,21 @@ public:
     sender& operator=(const sender& other) = delete;
     sender& operator=(sender&&) = default;
 
+    /*!
+     * Converts this sender into the pipelined one, which allows to keep several messages in flight.
+     *
+     * Available for streaming tags only, see \sa pipelined_sender.
+     *
+     * \warning this sender will be invalidated after this call.
+     */
+    auto pipeline(window_t window = window_t()) -> pipelined_sender<T, Session> {
+        BOOST_ASSERT(this->d);
+
+        return pipelined_sender<T, Session>(
+            std::make_shared<basic_pipeline_t<Session>>(std::move(this->d), window)
+        );
+    }
+
     /*!
      * Encode arguments to the internal protocol message and push it into the session attached.
      *
@@ -105,6 +300,49 @@ public:
         return future.then(trace_t::bind(&sender::traverse<Event>, std::placeholders::_1, std::move(d)));
     }
 
+    /*!
+     * Sets compression settings of the payloads sent via \sa write through this channel.
+     */
+    sender&
+    compress(compression_t compression) {
+        BOOST_ASSERT(this->d);
+
+        d->compress(std::move(compression));
+        return *this;
+    }
+
+    /*!
+     * Send the event with a single string argument, compressing it if it's large enough according
+     * to the compression settings.
+     *
+     * \warning this sender will be invalidated after this call.
+     */
+    template<class Event>
+    typename task<sender<typename io::event_traits<Event>::dispatch_type, Session>>::future_type
+    write(const std::string& data) {
+        BOOST_ASSERT(this->d);
+
+        auto d = std::move(this->d);
+        auto future = d->template write<Event>(data);
+        return future.then(trace_t::bind(&sender::traverse<Event>, std::placeholders::_1, std::move(d)));
+    }
+
+    /*!
+     * Send the event with a single string argument, gathering it from the given chunks without
+     * concatenating them first.
+     *
+     * \warning this sender will be invalidated after this call.
+     */
+    template<class Event>
+    typename task<sender<typename io::event_traits<Event>::dispatch_type, Session>>::future_type
+    gather(const buffers_t& buffers) {
+        BOOST_ASSERT(this->d);
+
+        auto d = std::move(this->d);
+        auto future = d->template gather<Event>(buffers);
+        return future.then(trace_t::bind(&sender::traverse<Event>, std::placeholders::_1, std::move(d)));
+    }
+
 private:
     template<class Event>
     static
@@ -115,6 +353,74 @@ private:
     }
 };
 
+/// The pipelined sender writes streaming protocol messages without waiting for previous chunks to
+/// be written, unlike the common sender does.
+///
+/// Up to the window limit of chunks are kept in flight, so large streams are limited by the socket
+/// throughput rather than by event loop wakeups.
+///
+/// For example:
+/// \code{.cpp}
+/// auto tx = channel.tx.pipeline();
+/// for (const auto& chunk : chunks) {
+///     // Blocks only if the window is full.
+///     tx.write(chunk).get();
+/// }
+/// tx.close().get();
+/// \endcode
+template<class T, class Session>
+class pipelined_sender<io::streaming_tag<T>, Session> {
+    typedef typename io::protocol<io::streaming_tag<T>>::scope protocol;
+
+    std::shared_ptr<basic_pipeline_t<Session>> d;
+
+public:
+    explicit
+    pipelined_sender(std::shared_ptr<basic_pipeline_t<Session>> d) :
+        d(std::move(d))
+    {}
+
+    /// Writes the next chunk.
+    ///
+    /// \returns a future, which is set when there is room for the next chunk in the window.
+    template<class... Args>
+    auto write(Args&&... args) -> task<void>::future_type {
+        return d->template push<typename protocol::chunk>(std::forward<Args>(args)...);
+    }
+
+    /// Writes the next chunk gathering it from the given buffers.
+    auto write(const buffers_t& buffers) -> task<void>::future_type {
+        return d->template gather<typename protocol::chunk>(buffers);
+    }
+
+    /// Writes the given data as one or more chunks, depending on the window slice size, compressing
+    /// them according to the sender compression settings.
+    auto slice(const std::string& data) -> task<void>::future_type {
+        return d->template slice<typename protocol::chunk>(data);
+    }
+
+    /// Sends an error after all previously written chunks, closing the stream.
+    ///
+    /// \returns a future, which is set when all messages are written.
+    auto error(const std::error_code& ec, const std::string& reason) -> task<void>::future_type {
+        d->template push<typename protocol::error>(ec, reason);
+        return d->flush();
+    }
+
+    /// Closes the stream after all previously written chunks.
+    ///
+    /// \returns a future, which is set when all messages are written.
+    auto close() -> task<void>::future_type {
+        d->template push<typename protocol::choke>();
+        return d->flush();
+    }
+
+    /// Returns a future, which is set when all chunks written so far are sent.
+    auto flush() -> task<void>::future_type {
+        return d->flush();
+    }
+};
+
 template<class Session>
 class sender<void, Session> {
 public:
@@ -19,6 +19,11 @@
 #include "cocaine/framework/forwards.hpp"
 #include "cocaine/framework/receiver.hpp"
 #include "cocaine/framework/service.inl.hpp"
+#include "cocaine/framework/service/broadcast.hpp"
+#include "cocaine/framework/service/cache.hpp"
+#include "cocaine/framework/service/coalesce.hpp"
+#include "cocaine/framework/service/hedge.hpp"
+#include "cocaine/framework/service/options.hpp"
 #include "cocaine/framework/session.hpp"
 #include "cocaine/framework/trace.hpp"
 #include "cocaine/framework/trace_logger.hpp"
@@ -36,15 +41,20 @@ namespace cocaine { namespace framework {
 ///
 /// You are restricted to create instances of this class directly, use \sa service_manager_t for
 /// this purposes.
+///
+/// Copies of a service share its sessions, resolver and caches, i.e. they are lightweight handles
+/// to the same service client.
 class basic_service_t {
 public:
     typedef session_t::native_handle_type native_handle_type;
     typedef std::vector<session_t::endpoint_type> endpoints_t;
 
 private:
+    /// Sessions selected for a broadcast along with the endpoints they are connected to.
+    typedef std::vector<std::pair<session_t::endpoint_type, std::shared_ptr<session_t>>> replicas_t;
+
     class impl;
-    std::unique_ptr<impl> d;
-    std::shared_ptr<session_t> session;
+    std::shared_ptr<impl> d;
     scheduler_t& scheduler;
     internal_logger_t logger;
 
@@ -56,7 +66,27 @@ public:
     /// \param version a protocol version number.
     /// \param locations list of the Locator endpoints which is usually well-known.
     /// \param scheduler an object which incapsulates an IO event loop inside itself.
-    basic_service_t(internal_logger_t logger, std::string name, uint version, endpoints_t locations, scheduler_t& scheduler);
+    /// \param options service client settings, like connection pool size.
+    basic_service_t(internal_logger_t logger,
+                    std::string name,
+                    uint version,
+                    endpoints_t locations,
+                    scheduler_t& scheduler,
+                    service_options_t options = service_options_t());
+
+    /// Constructs an instance of the service resolved through the given resolver, which may be
+    /// shared with other services.
+    ///
+    /// Resolve options of the resolver take precedence over the ones given with `options`.
+    basic_service_t(internal_logger_t logger,
+                    std::string name,
+                    uint version,
+                    std::shared_ptr<detail::serialized_resolver_t> resolver,
+                    scheduler_t& scheduler,
+                    service_options_t options = service_options_t());
+
+    /// Constructs a handle sharing the state of already existing instance.
+    basic_service_t(const basic_service_t& other);
 
     /// Constructs an instance of the service via moving already existing instance.
     basic_service_t(basic_service_t&& other);
@@ -73,9 +103,9 @@ public:
 
     auto hard_shutdown(bool policy = true) -> void;
 
-    /// Tries to connect to the service through the Locator.
+    /// Tries to connect all pooled sessions to the service through the Locator.
     ///
-    /// \returns a future which is set after the connection is established.
+    /// \returns a future which is set after all connections are established.
     future<void>
     connect();
 
@@ -89,35 +119,492 @@ public:
     native_handle_type
     native_handle() const;
 
+    /// Returns the number of outstanding invocations for each pooled session.
+    ///
+    /// In spread mode the result contains an entry for each session to each resolved endpoint.
+    std::vector<std::size_t>
+    inflight() const;
+
+    /// Drops the cached response of the given invocation if any.
+    template<class Event, class... Args>
+    void
+    invalidate(const Args&... args) {
+        if (auto cache = this->cache()) {
+            cache->erase(detail::key<Event>(args...));
+        }
+    }
+
+    /// Drops all cached responses.
+    void
+    invalidate();
+
+    /// Returns the response cache statistics.
+    cache_stats_t
+    cache_stats() const;
+
+    /// Returns the number of connection attempts failed locally with `service_not_found` error,
+    /// because the Locator has recently not found this service.
+    std::uint64_t
+    suppressed() const;
+
     template<class Event, class... Args>
     typename task<typename invocation_result<Event>::type>::future_type
     invoke(Args&&... args) {
+        trace::context_holder holder("SI");
+
+        typedef std::integral_constant<bool, detail::coalescable<Event>::value> coalescable;
+
+        return coalesce<Event>(coalescable(), std::forward<Args>(args)...);
+    }
+
+    /// Invokes the event on the service endpoint selected by the given routing key.
+    ///
+    /// In spread mode invocations with the same key go to the same endpoint while it's alive and
+    /// not overloaded, see \sa service_options_t::bound. This keeps per-node caches of sharded
+    /// services warm. Otherwise the key is ignored. Routed invocations are neither cached,
+    /// coalesced nor hedged.
+    template<class Event, class... Args>
+    typename task<typename invocation_result<Event>::type>::future_type
+    route(const std::string& key, Args&&... args) {
+        trace::context_holder holder("SR");
+
+        return send<Event>(key, std::forward<Args>(args)...);
+    }
+
+    /// Invokes the event on every endpoint of the service and gathers the replies.
+    ///
+    /// Requires spread mode, see \sa service_options_t::spread, where there is a session to each
+    /// resolved endpoint. All pooled sessions are connected first, see \sa connect, and then the
+    /// invocation reaches all endpoints in parallel. Broadcast invocations are neither cached,
+    /// coalesced nor hedged.
+    ///
+    /// \param deadline time after which endpoints that haven't replied yet get timeout error. Zero
+    /// means waiting for all replies.
+    /// \returns a future with a reply per endpoint, which throws `operation_not_supported` error
+    /// without spread mode, or throws if the service can't be resolved, or if the deadline expires
+    /// before the endpoints are known.
+    template<class Event, class... Args>
+    typename task<std::vector<broadcast_reply_t<typename invocation_result<Event>::type>>>::future_type
+    broadcast(std::chrono::milliseconds deadline, Args&&... args) {
         namespace ph = std::placeholders;
 
-        trace::context_holder holder("SI");
+        trace::context_holder holder("SG");
 
-        return connect()
-            .then(scheduler, trace::wrap(trace_t::bind(&basic_service_t::on_connect<Event, typename std::decay<Args>::type...>, ph::_1, session, std::forward<Args>(args)...)))
-            .then(scheduler, trace::wrap(trace_t::bind(&basic_service_t::on_invoke<Event>, ph::_1)));
+        typedef typename invocation_result<Event>::type result_type;
+
+        auto gather = std::make_shared<detail::gather_t<result_type>>();
+        auto future = gather->get_future();
+
+        if (deadline.count() > 0) {
+            expire(deadline, gather);
+        }
+
+        replicas()
+            .then(scheduler, trace::wrap(trace_t::bind(&basic_service_t::on_scatter<Event, typename std::decay<Args>::type...>, ph::_1, gather, std::forward<Args>(args)...)));
+
+        return future;
+    }
+
+    /// Sends a batch of invocations of the same event.
+    ///
+    /// If there is a connected session, the whole batch goes through it at once, see
+    /// \sa session::batch. Otherwise each invocation is sent separately. Batched invocations are
+    /// neither cached, coalesced nor hedged.
+    ///
+    /// \returns a future for each element of the batch in the same order.
+    template<class Event, class... Args>
+    std::vector<typename task<typename invocation_result<Event>::type>::future_type>
+    batch(const std::vector<std::tuple<Args...>>& invocations) {
+        namespace ph = std::placeholders;
+
+        trace::context_holder holder("SB");
+
+        std::vector<typename task<typename invocation_result<Event>::type>::future_type> result;
+        result.reserve(invocations.size());
+
+        if (auto session = select()) {
+            for (auto& future : session->batch<Event>(invocations)) {
+                result.push_back(future.then(trace::wrap(trace_t::bind(&basic_service_t::on_invoke<Event>, ph::_1))));
+            }
+
+            return result;
+        }
+
+        for (const auto& args : invocations) {
+            result.push_back(apply<Event>(args, typename make_index_sequence<sizeof...(Args)>::type()));
+        }
+
+        return result;
     }
 
 private:
+    template<class Event, class Tuple, std::size_t... Index>
+    typename task<typename invocation_result<Event>::type>::future_type
+    apply(const Tuple& args, index_sequence<Index...>) {
+        return do_invoke<Event>(std::false_type(), std::get<Index>(args)...);
+    }
+
+    /// Selects a pooled session for the next invocation, connecting it if required.
+    ///
+    /// The session is selected by the routing key if given, see \sa session_pool_t::select. It is
+    /// considered loaded until the returned pointer is destroyed.
+    future<std::shared_ptr<session_t>>
+    acquire(const boost::optional<std::string>& key = boost::none);
+
+    /// Selects an already connected pooled session without blocking.
+    ///
+    /// \returns none if the selected session is not connected, meaning that the invocation should
+    /// go through \sa acquire.
+    std::shared_ptr<session_t>
+    select(const boost::optional<std::string>& key = boost::none);
+
+    /// Connects all pooled sessions and selects a session to each endpoint for a broadcast.
+    ///
+    /// Sessions that have failed to connect are returned as well, unless the service couldn't be
+    /// resolved at all.
+    future<replicas_t>
+    replicas();
+
+    /// Expires the given broadcast after the deadline unless it completes earlier.
+    void
+    expire(std::chrono::milliseconds deadline, std::weak_ptr<detail::basic_gather_t> gather);
+
+    /// Checks whether hedging is enabled for this service.
+    bool
+    hedging() const noexcept;
+
+    /// Selects a connected session for the hedged attempt after the hedging delay expires.
+    ///
+    /// \returns a future, which throws if the race is already over or there are no sessions other
+    /// than the primary one.
+    future<std::shared_ptr<session_t>>
+    hedge(std::shared_ptr<detail::basic_race_t> race);
+
+    /// Returns the registry of in-flight invocations if coalescing is enabled, null otherwise.
+    std::shared_ptr<detail::flight_map_t>
+    flights() const;
+
+    /// Returns the response cache if caching is enabled, null otherwise.
+    std::shared_ptr<detail::response_cache_t>
+    cache() const;
+
+    template<class Event, class... Args>
+    typename task<typename invocation_result<Event>::type>::future_type
+    coalesce(std::false_type, Args&&... args) {
+        typedef std::integral_constant<bool, detail::hedgeable<Event>::value> hedgeable;
+
+        return do_invoke<Event>(hedgeable(), std::forward<Args>(args)...);
+    }
+
+    /// Serves the invocation from the response cache or joins an identical in-flight invocation
+    /// if either is enabled.
+    template<class Event, class... Args>
+    typename task<typename invocation_result<Event>::type>::future_type
+    coalesce(std::true_type, Args&&... args) {
+        namespace ph = std::placeholders;
+
+        typedef typename invocation_result<Event>::type result_type;
+        typedef detail::flight_t<result_type> flight_type;
+
+        auto flights = this->flights();
+        auto cache = this->cache();
+        if (!flights && !cache) {
+            return coalesce<Event>(std::false_type(), std::forward<Args>(args)...);
+        }
+
+        const auto key = detail::key<Event>(args...);
+
+        if (cache) {
+            if (auto packed = cache->get(key)) {
+                return make_ready_future<result_type>::value(detail::unpack<result_type>(*packed));
+            }
+        }
+
+        if (!flights) {
+            return fetch<Event>(std::move(cache), key, std::forward<Args>(args)...);
+        }
+
+        auto flight = std::make_shared<flight_type>();
+        auto leader = std::static_pointer_cast<flight_type>(flights->insert(key, flight));
+        auto future = leader->join();
+
+        if (leader != flight) {
+            return future;
+        }
+
+        fetch<Event>(std::move(cache), key, std::forward<Args>(args)...)
+            .then(trace::wrap(trace_t::bind(&basic_service_t::on_flight<result_type>, ph::_1, flights, key, flight)));
+
+        return future;
+    }
+
+    /// Sends the invocation, caching its response if the cache is given.
+    template<class Event, class... Args>
+    typename task<typename invocation_result<Event>::type>::future_type
+    fetch(std::shared_ptr<detail::response_cache_t> cache, const std::string& key, Args&&... args) {
+        namespace ph = std::placeholders;
+
+        typedef typename invocation_result<Event>::type result_type;
+
+        if (!cache) {
+            return coalesce<Event>(std::false_type(), std::forward<Args>(args)...);
+        }
+
+        const auto ttl = cache->ttl(io::event_traits<Event>::id);
+        const auto generation = cache->begin(key);
+
+        return coalesce<Event>(std::false_type(), std::forward<Args>(args)...)
+            .then(trace::wrap(trace_t::bind(&basic_service_t::on_fetch<result_type>, ph::_1, cache, key, ttl, generation)));
+    }
+
+    template<class Event, class... Args>
+    typename task<typename invocation_result<Event>::type>::future_type
+    do_invoke(std::false_type, Args&&... args) {
+        return send<Event>(boost::none, std::forward<Args>(args)...);
+    }
+
+    /// Sends the invocation through a session selected by the routing key if given.
+    template<class Event, class... Args>
+    typename task<typename invocation_result<Event>::type>::future_type
+    send(const boost::optional<std::string>& key, Args&&... args) {
+        namespace ph = std::placeholders;
+
+        if (auto session = select(key)) {
+            // Fast path: the session is already established, so encode and send the invocation
+            // right on the caller's thread without bouncing through the event loop.
+            try {
+                return session->invoke<Event>(std::forward<Args>(args)...)
+                    .then(trace::wrap(trace_t::bind(&basic_service_t::on_invoke<Event>, ph::_1)));
+            } catch (...) {
+                typedef typename invocation_result<Event>::type result_type;
+                return make_ready_future<result_type>::error(std::current_exception());
+            }
+        }
+
+        return acquire(key)
+            .then(scheduler, trace::wrap(trace_t::bind(&basic_service_t::on_acquire<Event, typename std::decay<Args>::type...>, ph::_1, std::forward<Args>(args)...)))
+            .then(scheduler, trace::wrap(trace_t::bind(&basic_service_t::on_invoke<Event>, ph::_1)));
+    }
+
+    template<class Event, class... Args>
+    typename task<typename invocation_result<Event>::type>::future_type
+    do_invoke(std::true_type, Args&&... args) {
+        namespace ph = std::placeholders;
+
+        if (!hedging()) {
+            return do_invoke<Event>(std::false_type(), std::forward<Args>(args)...);
+        }
+
+        typedef typename invocation_result<Event>::type result_type;
+        typedef detail::race_t<result_type> race_type;
+
+        auto race = std::make_shared<race_type>();
+        auto future = race->get_future();
+
+        // Both attempts send the same arguments, so they are copied once here.
+        std::function<void(std::shared_ptr<session_t>)> attempt = std::bind(
+            &basic_service_t::on_attempt<Event, typename std::decay<Args>::type...>,
+            ph::_1,
+            race,
+            std::forward<Args>(args)...
+        );
+
+        race->start();
+        acquire()
+            .then(scheduler, trace::wrap(trace_t::bind(&basic_service_t::on_race<result_type>, ph::_1, race, attempt, true)));
+        hedge(race)
+            .then(scheduler, trace::wrap(trace_t::bind(&basic_service_t::on_race<result_type>, ph::_1, race, attempt, false)));
+
+        return future;
+    }
+
     template<class Event, class... Args>
     static
     typename task<channel<Event>>::future_type
-    on_connect(task<void>::future_move_type future, std::shared_ptr<session_t> session, Args&... args) {
-        future.get();
+    on_acquire(typename task<std::shared_ptr<session_t>>::future_move_type future, Args&... args) {
+        auto session = future.get();
         // Between these calls no one can guarantee, that the connection won't be broken. In this
         // case you will get a system error after either write or read attempt.
         return session->invoke<Event>(std::forward<Args>(args)...);
     }
 
+    template<class Event, class... Args>
+    static
+    void
+    on_scatter(typename task<replicas_t>::future_move_type future,
+               std::shared_ptr<detail::gather_t<typename invocation_result<Event>::type>> gather,
+               Args&... args)
+    {
+        namespace ph = std::placeholders;
+
+        typedef typename invocation_result<Event>::type result_type;
+
+        replicas_t replicas;
+
+        try {
+            replicas = future.get();
+        } catch (...) {
+            gather->fail(std::current_exception());
+            return;
+        }
+
+        for (auto& replica : replicas) {
+            const auto id = gather->add(replica.first);
+
+            if (!replica.second->connected()) {
+                gather->set_exception(id, std::make_exception_ptr(std::system_error(asio::error::not_connected)));
+                continue;
+            }
+
+            // Arguments are copied for each endpoint.
+            try {
+                replica.second->invoke<Event>(args...)
+                    .then(trace::wrap(trace_t::bind(&basic_service_t::on_invoke<Event>, ph::_1)))
+                    .then(trace::wrap(trace_t::bind(&basic_service_t::on_gather<result_type>, ph::_1, gather, id)));
+            } catch (...) {
+                gather->set_exception(id, std::current_exception());
+            }
+        }
+
+        gather->seal();
+    }
+
+    template<class T>
+    static
+    void
+    on_gather(typename task<T>::future_move_type future, std::shared_ptr<detail::gather_t<T>> gather, std::size_t id) {
+        gather->set(id, future);
+    }
+
     template<class Event>
     static
     typename task<typename invocation_result<Event>::type>::future_type
     on_invoke(typename task<channel<Event>>::future_move_type future) {
         return invocation_result<Event>::apply(future.get());
     }
+
+    template<class T>
+    static
+    void
+    on_race(typename task<std::shared_ptr<session_t>>::future_move_type future,
+            std::shared_ptr<detail::race_t<T>> race,
+            const std::function<void(std::shared_ptr<session_t>)>& attempt,
+            bool primary)
+    {
+        std::shared_ptr<session_t> session;
+
+        try {
+            session = future.get();
+        } catch (...) {
+            // The hedged attempt is accounted only when started, so its failure here means nothing.
+            if (primary) {
+                race->set_exception(std::current_exception());
+            }
+            return;
+        }
+
+        if (primary) {
+            race->assign(session.get());
+        } else if (!race->start()) {
+            return;
+        }
+
+        attempt(std::move(session));
+    }
+
+    template<class Event, class... Args>
+    static
+    void
+    on_attempt(std::shared_ptr<session_t> session,
+               std::shared_ptr<detail::race_t<typename invocation_result<Event>::type>> race,
+               const Args&... args)
+    {
+        namespace ph = std::placeholders;
+
+        try {
+            session->invoke<Event>(args...)
+                .then(trace::wrap(trace_t::bind(&basic_service_t::on_race_invoke<Event>, ph::_1, race, session)));
+        } catch (...) {
+            race->set_exception(std::current_exception());
+        }
+    }
+
+    template<class Event>
+    static
+    void
+    on_race_invoke(typename task<channel<Event>>::future_move_type future,
+                   std::shared_ptr<detail::race_t<typename invocation_result<Event>::type>> race,
+                   std::shared_ptr<session_t> /* lease */)
+    {
+        namespace ph = std::placeholders;
+
+        typedef typename invocation_result<Event>::type result_type;
+
+        try {
+            auto channel = future.get();
+
+            // If the race is already over the channel is revoked on destruction.
+            if (!race->track(channel.rx.revoker())) {
+                return;
+            }
+
+            invocation_result<Event>::apply(std::move(channel))
+                .then(trace::wrap(trace_t::bind(&basic_service_t::on_race_recv<result_type>, ph::_1, race)));
+        } catch (...) {
+            race->set_exception(std::current_exception());
+        }
+    }
+
+    template<class T>
+    static
+    T
+    on_fetch(typename task<T>::future_move_type future,
+             std::shared_ptr<detail::response_cache_t> cache,
+             const std::string& key,
+             std::chrono::milliseconds ttl,
+             std::uint64_t generation)
+    {
+        T value;
+
+        try {
+            value = future.get();
+        } catch (...) {
+            cache->cancel(key);
+            throw;
+        }
+
+        cache->put(key, detail::pack(value), ttl, generation);
+        return value;
+    }
+
+    template<class T>
+    static
+    void
+    on_flight(typename task<T>::future_move_type future,
+              std::shared_ptr<detail::flight_map_t> flights,
+              const std::string& key,
+              std::shared_ptr<detail::flight_t<T>> flight)
+    {
+        // Invocations made from now on can't join this flight, because the response may be stale.
+        flights->erase(key, flight);
+
+        try {
+            flight->set_value(future.get());
+        } catch (...) {
+            flight->set_exception(std::current_exception());
+        }
+    }
+
+    template<class T>
+    static
+    void
+    on_race_recv(typename task<T>::future_move_type future, std::shared_ptr<detail::race_t<T>> race) {
+        try {
+            race->set_value(future.get());
+        } catch (...) {
+            race->set_exception(std::current_exception());
+        }
+    }
 };
 
 /// The service class represents a typed Cocaine service.
@@ -127,8 +614,25 @@ private:
 template<class T>
 class service : public basic_service_t {
 public:
-    service(internal_logger_t logger, std::string name, endpoints_t locations, scheduler_t& scheduler) :
-        basic_service_t(std::move(logger), std::move(name), io::protocol<T>::version::value, std::move(locations), scheduler)
+    service(internal_logger_t logger,
+            std::string name,
+            endpoints_t locations,
+            scheduler_t& scheduler,
+            service_options_t options = service_options_t()) :
+        basic_service_t(std::move(logger),
+                        std::move(name),
+                        io::protocol<T>::version::value,
+                        std::move(locations),
+                        scheduler,
+                        std::move(options))
+    {}
+
+    /// Constructs a handle sharing the state of the given untyped service.
+    ///
+    /// \pre the service must have been created with the same protocol version.
+    explicit
+    service(const basic_service_t& other) :
+        basic_service_t(other)
     {}
 };
 
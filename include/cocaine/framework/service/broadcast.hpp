@@ -0,0 +1,194 @@
+/*
+    Copyright (c) 2015 Evgeny Safronov <division494@gmail.com>
+    Copyright (c) 2011-2015 Other contributors as noted in the AUTHORS file.
+    This file is part of Cocaine.
+    Cocaine is free software; you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+    Cocaine is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Lesser General Public License for more details.
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <system_error>
+#include <vector>
+
+#include <asio/error.hpp>
+
+#include "cocaine/framework/forwards.hpp"
+#include "cocaine/framework/session.hpp"
+
+namespace cocaine { namespace framework {
+
+/// Reply of a single service endpoint to a broadcast invocation.
+template<class T>
+struct broadcast_reply_t {
+    session_t::endpoint_type endpoint;
+
+    /// Ready future, which either contains the response or throws the invocation error.
+    ///
+    /// Endpoints that haven't replied before the deadline get `asio::error::timed_out` error.
+    typename task<T>::future_type result;
+};
+
+namespace detail {
+
+/// Type-erased state of a broadcast invocation, so it can be expired by a timer.
+///
+/// \internal
+class basic_gather_t {
+public:
+    virtual
+    ~basic_gather_t() {}
+
+    /// Completes the broadcast, failing all endpoints that haven't replied yet with timeout error.
+    ///
+    /// If endpoints are not known yet, the whole broadcast fails with timeout error.
+    virtual
+    void
+    expire() = 0;
+};
+
+/// Collects replies of all endpoints to a broadcast invocation.
+///
+/// The aggregate result is set when either all endpoints have replied or the deadline expires,
+/// whichever comes first. Late replies are dropped.
+///
+/// \internal
+/// \threadsafe
+template<class T>
+class gather_t : public basic_gather_t {
+public:
+    typedef broadcast_reply_t<T> reply_type;
+
+private:
+    std::vector<reply_type> replies;
+    std::size_t pending;
+    bool sealed;
+    bool done;
+
+    typename task<std::vector<reply_type>>::promise_type promise;
+
+    std::mutex mutex;
+
+public:
+    gather_t() :
+        pending(0),
+        sealed(false),
+        done(false)
+    {}
+
+    auto get_future() -> typename task<std::vector<reply_type>>::future_type {
+        return promise.get_future();
+    }
+
+    /// Registers an endpoint to wait for.
+    ///
+    /// \returns the index of its reply.
+    auto add(session_t::endpoint_type endpoint) -> std::size_t {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        replies.push_back(reply_type{ std::move(endpoint), typename task<T>::future_type() });
+        ++pending;
+        return replies.size() - 1;
+    }
+
+    /// Stores the reply of the given endpoint.
+    void
+    set(std::size_t id, typename task<T>::future_move_type result) {
+        std::unique_lock<std::mutex> lock(mutex);
+
+        if (done || replies[id].result.valid()) {
+            return;
+        }
+
+        replies[id].result = std::move(result);
+        --pending;
+
+        complete(lock);
+    }
+
+    void
+    set_exception(std::size_t id, std::exception_ptr err) {
+        auto result = make_ready_future<T>::error(std::move(err));
+        set(id, result);
+    }
+
+    /// Marks that all endpoints have been registered.
+    void
+    seal() {
+        std::unique_lock<std::mutex> lock(mutex);
+
+        sealed = true;
+        complete(lock);
+    }
+
+    /// Fails the whole broadcast, for example if the service can't be resolved.
+    void
+    fail(std::exception_ptr err) {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        if (done) {
+            return;
+        }
+
+        done = true;
+        promise.set_exception(std::move(err));
+    }
+
+    void
+    expire() {
+        std::unique_lock<std::mutex> lock(mutex);
+
+        if (done) {
+            return;
+        }
+
+        if (!sealed) {
+            // The service hasn't been resolved or connected yet, so there is nobody to reply.
+            done = true;
+            lock.unlock();
+
+            promise.set_exception(std::system_error(asio::error::timed_out));
+            return;
+        }
+
+        for (auto& reply : replies) {
+            if (!reply.result.valid()) {
+                reply.result = make_ready_future<T>::error(std::system_error(asio::error::timed_out));
+            }
+        }
+
+        pending = 0;
+        sealed = true;
+        complete(lock);
+    }
+
+private:
+    void
+    complete(std::unique_lock<std::mutex>& lock) {
+        if (done || !sealed || pending > 0) {
+            return;
+        }
+
+        done = true;
+        auto result = std::move(replies);
+        lock.unlock();
+
+        promise.set_value(std::move(result));
+    }
+};
+
+} // namespace detail
+
+}} // namespace cocaine::framework
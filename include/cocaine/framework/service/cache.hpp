@@ -0,0 +1,165 @@
+/*
+    Copyright (c) 2015 Evgeny Safronov <division494@gmail.com>
+    Copyright (c) 2011-2015 Other contributors as noted in the AUTHORS file.
+    This file is part of Cocaine.
+    Cocaine is free software; you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+    Cocaine is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Lesser General Public License for more details.
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include <boost/optional/optional.hpp>
+
+#include <cocaine/traits.hpp>
+
+#include "cocaine/framework/service/options.hpp"
+
+namespace cocaine { namespace framework {
+
+/// Response cache statistics snapshot.
+struct cache_stats_t {
+    /// Number of invocations served from the cache.
+    std::uint64_t hits;
+    /// Number of cacheable invocations sent to the service.
+    std::uint64_t misses;
+    /// Number of cached responses.
+    std::size_t entries;
+    /// Memory occupied by cached keys and responses in bytes.
+    std::size_t bytes;
+};
+
+namespace detail {
+
+/// Packs the given value into the MessagePack'ed string.
+///
+/// \internal
+template<class T>
+auto pack(const T& value) -> std::string {
+    msgpack::sbuffer buffer;
+    msgpack::packer<msgpack::sbuffer> packer(buffer);
+    io::type_traits<T>::pack(packer, value);
+    return std::string(buffer.data(), buffer.size());
+}
+
+/// \internal
+template<class T>
+auto unpack(const std::string& data) -> T {
+    msgpack::unpacked msg;
+    msgpack::unpack(&msg, data.data(), data.size());
+
+    T value;
+    io::type_traits<T>::unpack(msg.get(), value);
+    return value;
+}
+
+/// Bounded LRU cache of MessagePack'ed responses keyed by encoded invocations.
+///
+/// \internal
+/// \threadsafe
+class response_cache_t {
+    struct entry_t {
+        std::string key;
+        std::string value;
+        std::chrono::steady_clock::time_point expires;
+
+        auto size() const -> std::size_t {
+            return 2 * key.size() + value.size();
+        }
+    };
+
+    typedef std::list<entry_t> list_type;
+
+    /// Cacheable invocations with the same key in flight.
+    struct pending_t {
+        std::size_t count;
+
+        /// Incremented on each invalidation of the key to reject responses of invocations started
+        /// before it.
+        std::uint64_t generation;
+    };
+
+    const cache_options_t options;
+
+    list_type entries;
+    std::unordered_map<std::string, list_type::iterator> index;
+    std::size_t bytes;
+
+    std::atomic<std::uint64_t> hits;
+    std::atomic<std::uint64_t> misses;
+
+    /// Keys of cacheable invocations in flight. An entry lives only while there are invocations
+    /// with its key in flight, so invalidations don't leave anything behind.
+    std::unordered_map<std::string, pending_t> pending;
+
+    mutable std::mutex mutex;
+
+public:
+    explicit
+    response_cache_t(cache_options_t options);
+
+    /// Returns the time-to-live of responses for the event with the given id.
+    auto ttl(int id) const -> std::chrono::milliseconds;
+
+    /// Returns the cached response if present and not expired, accounting a hit or a miss.
+    auto get(const std::string& key) -> boost::optional<std::string>;
+
+    /// Registers a cacheable invocation with the given key in flight.
+    ///
+    /// Each call must be paired with either `put` or `cancel`.
+    ///
+    /// \returns the invalidation generation of the key, which must be passed to `put`.
+    auto begin(const std::string& key) -> std::uint64_t;
+
+    /// Caches the response of the invocation registered with `begin`, evicting the least recently
+    /// used ones to fit the capacity.
+    ///
+    /// Responses larger than the whole cache capacity are not cached, as well as responses of
+    /// invocations started before the key or the whole cache was invalidated, i.e. with outdated
+    /// generation.
+    void
+    put(const std::string& key, std::string value, std::chrono::milliseconds ttl, std::uint64_t generation);
+
+    /// Unregisters the failed invocation registered with `begin`.
+    void
+    cancel(const std::string& key);
+
+    void
+    erase(const std::string& key);
+
+    void
+    clear();
+
+    auto stats() const -> cache_stats_t;
+
+private:
+    /// \pre mutex is locked.
+    void
+    erase(list_type::iterator it);
+
+    /// Unregisters the invocation with the given key.
+    ///
+    /// \pre mutex is locked.
+    /// \returns whether the key generation still equals the given one.
+    auto finish(const std::string& key, std::uint64_t generation) -> bool;
+};
+
+} // namespace detail
+
+}} // namespace cocaine::framework
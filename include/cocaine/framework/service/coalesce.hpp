@@ -0,0 +1,156 @@
+/*
+    Copyright (c) 2015 Evgeny Safronov <division494@gmail.com>
+    Copyright (c) 2011-2015 Other contributors as noted in the AUTHORS file.
+    This file is part of Cocaine.
+    Cocaine is free software; you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+    Cocaine is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Lesser General Public License for more details.
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+#include <boost/optional/optional.hpp>
+
+#include <cocaine/rpc/asio/encoder.hpp>
+
+#include "cocaine/framework/encoder.hpp"
+#include "cocaine/framework/forwards.hpp"
+#include "cocaine/framework/service/hedge.hpp"
+
+namespace cocaine { namespace framework { namespace detail {
+
+/// Checks whether identical concurrent invocations of the given event can be joined into a single
+/// one.
+///
+/// The same requirements as for hedging apply: the event must be marked as idempotent and must
+/// have a single response message.
+///
+/// \internal
+template<class Event>
+struct coalescable : public std::integral_constant<bool, hedgeable<Event>::value> {};
+
+/// Returns a key uniquely identifying the invocation of the given event with the given arguments.
+///
+/// The key is the encoded event with zero span, which consists of both the event id and the
+/// MessagePack'ed arguments.
+///
+/// \internal
+template<class Event, class... Args>
+auto key(const Args&... args) -> std::string {
+    const auto message = encode_args<Event>(0, args...);
+    return std::string(message.data(), message.size());
+}
+
+/// \internal
+class basic_flight_t {
+public:
+    virtual ~basic_flight_t();
+};
+
+/// Single in-flight invocation, whose result is delivered to all joined callers.
+///
+/// \internal
+/// \threadsafe
+template<class T>
+class flight_t : public basic_flight_t {
+    bool done;
+    boost::optional<T> value;
+    std::exception_ptr error;
+    std::vector<typename task<T>::promise_type> promises;
+
+    std::mutex mutex;
+
+public:
+    flight_t() :
+        done(false)
+    {}
+
+    /// Returns a future with the result of this flight.
+    ///
+    /// Callers joined after completion immediately receive a copy of the result.
+    auto join() -> typename task<T>::future_type {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        if (done) {
+            if (error) {
+                return make_ready_future<T>::error(error);
+            }
+
+            return make_ready_future<T>::value(*value);
+        }
+
+        promises.emplace_back();
+        return promises.back().get_future();
+    }
+
+    void
+    set_value(T value) {
+        auto promises = complete([&] {
+            this->value = std::move(value);
+        });
+
+        for (auto& promise : promises) {
+            promise.set_value(*this->value);
+        }
+    }
+
+    void
+    set_exception(std::exception_ptr error) {
+        auto promises = complete([&] {
+            this->error = error;
+        });
+
+        for (auto& promise : promises) {
+            promise.set_exception(error);
+        }
+    }
+
+private:
+    template<class F>
+    auto complete(F f) -> std::vector<typename task<T>::promise_type> {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        f();
+        done = true;
+
+        return std::move(promises);
+    }
+};
+
+/// Registry of in-flight invocations keyed by their encoded representation.
+///
+/// \internal
+/// \threadsafe
+class flight_map_t {
+    std::unordered_map<std::string, std::shared_ptr<basic_flight_t>> flights;
+    std::mutex mutex;
+
+public:
+    /// Returns the flight registered with the given key, registering the given one if there is
+    /// none.
+    auto insert(const std::string& key, std::shared_ptr<basic_flight_t> flight) -> std::shared_ptr<basic_flight_t>;
+
+    /// Unregisters the given flight, unless the key has already been taken by another one.
+    void
+    erase(const std::string& key, const std::shared_ptr<basic_flight_t>& flight);
+
+    /// Returns the number of flights in progress.
+    auto size() -> std::size_t;
+};
+
+}}} // namespace cocaine::framework::detail
@@ -0,0 +1,150 @@
+/*
+    Copyright (c) 2015 Evgeny Safronov <division494@gmail.com>
+    Copyright (c) 2011-2015 Other contributors as noted in the AUTHORS file.
+    This file is part of Cocaine.
+    Cocaine is free software; you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+    Cocaine is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Lesser General Public License for more details.
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <type_traits>
+#include <vector>
+
+#include <cocaine/rpc/protocol.hpp>
+
+#include "cocaine/framework/forwards.hpp"
+
+namespace cocaine { namespace framework {
+
+/// The trait marks an event as idempotent, i.e. safe to be delivered to the service several times.
+///
+/// Invocations of idempotent events with a single response message (primitive tags) are hedged
+/// if the service is configured so, see \sa service_options_t::hedge. No events are idempotent by
+/// default, specialize this trait to opt in.
+///
+/// For example:
+/// \code{.cpp}
+/// namespace cocaine { namespace framework {
+///
+/// template<>
+/// struct idempotent<io::storage::read> : public std::true_type {};
+///
+/// }}
+/// \endcode
+template<class Event>
+struct idempotent : public std::false_type {};
+
+namespace detail {
+
+/// \internal
+template<class Upstream>
+struct is_primitive : public std::false_type {};
+
+/// \internal
+template<class T>
+struct is_primitive<io::primitive_tag<T>> : public std::true_type {};
+
+/// Checks whether invocations of the given event can be hedged.
+///
+/// \internal
+template<class Event>
+struct hedgeable : public std::integral_constant<
+    bool,
+    idempotent<Event>::value && is_primitive<typename io::event_traits<Event>::upstream_type>::value
+> {};
+
+/// Type-erased state of a hedged invocation, where several attempts race for a single result.
+///
+/// The first successful attempt wins and revokes channels of the others. The invocation fails only
+/// if all started attempts have failed.
+///
+/// \internal
+/// \threadsafe
+class basic_race_t {
+    std::size_t started;
+    std::size_t failed;
+    bool done;
+
+    /// Session of the primary attempt. Used only for comparison.
+    const session_t* primary_;
+
+    std::vector<std::function<void()>> revokers;
+
+    mutable std::mutex mutex;
+
+public:
+    basic_race_t();
+
+    /// Accounts a new attempt.
+    ///
+    /// \returns false if the race is already over, meaning that the attempt should not be made.
+    auto start() -> bool;
+
+    /// Checks whether the race is over.
+    auto completed() const -> bool;
+
+    void
+    assign(const session_t* session);
+
+    auto primary() const -> const session_t*;
+
+    /// Registers a revoker of the channel created by an attempt, or any other cleanup, which is
+    /// called once the race is over either way.
+    ///
+    /// \returns false if the race is already over, meaning that the channel should be dropped.
+    auto track(std::function<void()> revoker) -> bool;
+
+protected:
+    /// Marks the race as won, calling all tracked revokers.
+    ///
+    /// \returns true if the caller is the winner and should set the result.
+    auto finish() -> bool;
+
+    /// Accounts a failed attempt, calling all tracked revokers if it was the last one.
+    ///
+    /// \returns true if there are no attempts left and the caller should set the error.
+    auto fail() -> bool;
+};
+
+/// \internal
+template<class T>
+class race_t : public basic_race_t {
+    typename task<T>::promise_type promise;
+
+public:
+    auto get_future() -> typename task<T>::future_type {
+        return promise.get_future();
+    }
+
+    void
+    set_value(T value) {
+        if (finish()) {
+            promise.set_value(std::move(value));
+        }
+    }
+
+    void
+    set_exception(std::exception_ptr err) {
+        if (fail()) {
+            promise.set_exception(std::move(err));
+        }
+    }
+};
+
+} // namespace detail
+
+}} // namespace cocaine::framework
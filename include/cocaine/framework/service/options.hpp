@@ -0,0 +1,184 @@
+/*
+    Copyright (c) 2015 Evgeny Safronov <division494@gmail.com>
+    Copyright (c) 2011-2015 Other contributors as noted in the AUTHORS file.
+    This file is part of Cocaine.
+    Cocaine is free software; you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+    Cocaine is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Lesser General Public License for more details.
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <map>
+
+#include <cocaine/rpc/protocol.hpp>
+
+namespace cocaine { namespace framework {
+
+/// Settings of the client-side response cache.
+///
+/// Only responses of events marked with \sa idempotent trait having a single response message are
+/// cached.
+struct cache_options_t {
+    /// Maximum memory occupied by cached invocation keys and responses in bytes.
+    ///
+    /// Zero disables caching.
+    std::size_t capacity;
+
+    /// Default time-to-live of cached responses.
+    std::chrono::milliseconds ttl;
+
+    /// Per-event time-to-live overrides keyed by event id. Zero value disables caching of the
+    /// event.
+    std::map<int, std::chrono::milliseconds> ttls;
+
+    cache_options_t() :
+        capacity(0),
+        ttl(1000)
+    {}
+
+    /// Overrides time-to-live of the given event responses.
+    template<class Event>
+    cache_options_t&
+    expire(std::chrono::milliseconds ttl) {
+        ttls[io::event_traits<Event>::id] = ttl;
+        return *this;
+    }
+};
+
+/// Settings of the resolve result cache.
+///
+/// Cached endpoints are dropped when connecting to them fails, so the next attempt asks the
+/// Locator again.
+struct resolve_options_t {
+    /// How long resolved endpoints and protocol version are reused without asking the Locator.
+    ///
+    /// Zero disables caching, i.e. each connection attempt resolves the service.
+    std::chrono::milliseconds ttl;
+
+    /// How long after the expiration the cached result is still returned, while it's being
+    /// refreshed in the background.
+    std::chrono::milliseconds stale;
+
+    /// Whether to subscribe to the Locator service announcements.
+    ///
+    /// If set, a moved service gets its cached endpoints updated and the new endpoints connected
+    /// before the old ones fail, instead of after the next connection error.
+    bool watch;
+
+    /// Time after which a resolve is considered failed and retried with another Locator, if
+    /// there are several of them.
+    ///
+    /// Zero disables the timeout.
+    std::chrono::milliseconds timeout;
+
+    /// Period during which resolves of a service that the Locator has not found fail locally with
+    /// `service_not_found` error.
+    ///
+    /// Each subsequent miss doubles this period up to `negative_cap`, the actual period is
+    /// randomly jittered. Zero disables negative caching.
+    std::chrono::milliseconds negative;
+
+    /// Upper bound for the negative caching period.
+    std::chrono::milliseconds negative_cap;
+
+    resolve_options_t() :
+        ttl(0),
+        stale(0),
+        watch(false),
+        timeout(0),
+        negative(0),
+        negative_cap(30000)
+    {}
+};
+
+/// Tunable settings of a single service client.
+///
+/// Default constructed options give the classic behavior: one connection per service.
+struct service_options_t {
+    /// Number of sessions (i.e. TCP connections) kept to the service.
+    ///
+    /// If `spread` is set, this number of sessions is kept to each resolved endpoint.
+    std::size_t pool;
+
+    /// Whether to keep connections to all endpoints the Locator resolves the service to.
+    ///
+    /// If set, each invocation is routed using the "power of two choices" rule: two random
+    /// sessions are compared by their observed latency and in-flight counts, and the better one is
+    /// picked. Otherwise all sessions connect to the first reachable endpoint and the session with
+    /// the fewest in-flight channels is picked. Broadcasting requires this mode.
+    bool spread;
+
+    /// Load bound of routing invocations by key in spread mode, see \sa basic_service_t::route.
+    ///
+    /// An endpoint accepts keyed invocations while its outstanding invocations do not exceed this
+    /// factor times the average over all endpoints, otherwise the next endpoint on the hash ring
+    /// is tried. Lower values spread hot keys faster at the expense of locality. Must be at least
+    /// one.
+    double bound;
+
+    /// How long a session is excluded from routing after a failed connection attempt.
+    ///
+    /// Each subsequent failure doubles this period up to `backoff`, the actual period is randomly
+    /// jittered to avoid synchronized reconnection storms. While all sessions are quarantined
+    /// invocations that require a connection fail immediately with the last connection error.
+    std::chrono::milliseconds quarantine;
+
+    /// Upper bound for both session quarantine and circuit breaker open periods.
+    std::chrono::milliseconds backoff;
+
+    /// Number of consecutive failed connection attempts after which the circuit opens.
+    ///
+    /// While the circuit is open invocations that require a connection fail immediately with
+    /// `service_unavailable` error. After the open period expires a single probe attempt is
+    /// allowed: if it succeeds the circuit closes, otherwise it opens again for a longer period.
+    /// Zero disables circuit breaking, which is the default.
+    std::size_t threshold;
+
+    /// Delay after which an idempotent invocation is duplicated to another connected session if
+    /// there is still no response.
+    ///
+    /// The first response wins, the channel of the other invocation is revoked. Only events marked
+    /// with \sa idempotent trait having a single response message are hedged. Zero disables
+    /// hedging.
+    ///
+    /// The delay is fixed rather than derived from the observed latency: sessions track only the
+    /// average latency, which says nothing about the tail, so set it to about the p95 latency of
+    /// the service measured elsewhere.
+    std::chrono::milliseconds hedge;
+
+    /// Whether to join identical concurrent invocations into a single one.
+    ///
+    /// Invocations are identical if they have the same event and encoded arguments. All joined
+    /// callers receive a copy of the single response. The same event restrictions as for hedging
+    /// apply.
+    bool coalesce;
+
+    /// Client-side response cache settings. Disabled by default.
+    cache_options_t cache;
+
+    /// Resolve result cache settings. Disabled by default.
+    resolve_options_t resolve;
+
+    service_options_t() :
+        pool(1),
+        spread(false),
+        bound(1.25),
+        quarantine(1000),
+        backoff(30000),
+        threshold(0),
+        hedge(0),
+        coalesce(false)
+    {}
+};
+
+}} // namespace cocaine::framework
@@ -16,7 +16,10 @@
 
 #pragma once
 
+#include <chrono>
 #include <cstdint>
+#include <tuple>
+#include <vector>
 
 #include <boost/asio/ip/tcp.hpp>
 
@@ -75,20 +78,58 @@ public:
     native_handle_type
     native_handle() const;
 
+    /// Returns the number of channels currently registered in this session.
+    auto inflight() const -> std::size_t;
+
+    /// Returns the smoothed response latency observed by this session.
+    auto latency() const -> std::chrono::microseconds;
+
     template<class Event, class... Args>
     typename task<channel<Event>>::future_type
     invoke(Args&&... args) {
-        auto encode_cb = std::bind(
-                    &encode<Event, Args...>,
-                    std::placeholders::_1,
-                    std::forward<Args>(args)...
-        );
-        return invoke(std::move(encode_cb)).then(scheduler, trace_t::bind(&session::on_invoke<Event>, std::placeholders::_1));
+        // The message is encoded synchronously, so arguments are packed in place instead of being
+        // copied into a type-erased callback. A single \sa prepared event is sent as is.
+        auto encode_cb = [&](std::uint64_t span) -> io::encoder_t::message_type {
+            return detail::encode_args<Event>(span, args...);
+        };
+
+        // Wrapping the result into a channel is cheap, so there is no need to post it into the
+        // event loop.
+        return invoke(encode_ref_t(encode_cb)).then(trace_t::bind(&session::on_invoke<Event>, std::placeholders::_1));
+    }
+
+    /// Sends a batch of invocations of the same event at once.
+    ///
+    /// Channel ids are allocated as a contiguous range, all channels are registered in one step
+    /// and all frames are written back to back.
+    ///
+    /// \returns a channel future for each element of the batch in the same order.
+    template<class Event, class... Args>
+    std::vector<typename task<channel<Event>>::future_type>
+    batch(const std::vector<std::tuple<Args...>>& batch) {
+        // The batch is encoded synchronously, so it's safe to pass it by reference.
+        auto encode_cb = [&](std::uint64_t span, std::size_t id) -> io::encoder_t::message_type {
+            return encode_batch<Event, Args...>(span, id, batch);
+        };
+
+        auto futures = invoke(batch.size(), batch_encode_ref_t(encode_cb));
+
+        std::vector<typename task<channel<Event>>::future_type> result;
+        result.reserve(futures.size());
+
+        for (auto& future : futures) {
+            result.push_back(future.then(trace_t::bind(&session::on_invoke<Event>, std::placeholders::_1)));
+        }
+
+        return result;
     }
 
 private:
     task<basic_invoke_result>::future_type
-    invoke(encode_callback_t encode_callback);
+    invoke(encode_ref_t encode_callback);
+
+    std::vector<task<basic_invoke_result>::future_type>
+    invoke(std::size_t size, batch_encode_ref_t encode_callback);
 
     template<class Event>
     static
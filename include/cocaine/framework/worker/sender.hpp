@@ -22,11 +22,14 @@
 #include <cocaine/forwards.hpp>
 
 #include "cocaine/framework/forwards.hpp"
+#include "cocaine/framework/sender.hpp"
 
 namespace cocaine {
 namespace framework {
 namespace worker {
 
+class pipelined_sender;
+
 class sender {
     std::shared_ptr<basic_sender_t<worker_session_t>> session;
 
@@ -44,12 +47,23 @@ public:
     auto operator=(const sender& other) -> sender& = delete;
     auto operator=(sender&& other) -> sender& = default;
 
+    /// Sets compression settings of messages written into the associated channel, including ones
+    /// written through the pipelined sender converted from this one.
+    ///
+    /// Compression is transparent for clients built on this framework.
+    auto compress(compression_t compression) -> sender&;
+
     /// Writes the provided message into the associated channel.
     ///
     /// \warning this sender will be invalidated after this call. The proper signature should
     ///     involve rvalue reference from this, but our compilers doesn't support it yey.
     auto write(std::string message) -> task<sender>::future_type;
 
+    /// Writes the message gathered from the given buffers without concatenating them first.
+    ///
+    /// \warning this sender will be invalidated after this call.
+    auto write(const buffers_t& buffers) -> task<sender>::future_type;
+
     /// Sends an error into the associated channel.
     ///
     /// \warning this sender will be invalidated after this call. The proper signature should
@@ -62,6 +76,57 @@ public:
     /// \warning this sender will be invalidated after this call. The proper signature should
     ///     involve rvalue reference from this, but our compilers doesn't support it yey.
     auto close() -> task<void>::future_type;
+
+    /// Converts this sender into the pipelined one, which doesn't wait for each chunk to be
+    /// written before allowing to write the next one.
+    ///
+    /// \warning this sender will be invalidated after this call.
+    auto pipeline(window_t window = window_t()) -> pipelined_sender;
+};
+
+/// The pipelined sender keeps up to the window limit of chunks in flight, preserving their order.
+///
+/// Prefer it over the common sender when streaming large responses, because the common one
+/// serializes each chunk write through the event loop.
+class pipelined_sender {
+    std::shared_ptr<basic_pipeline_t<worker_session_t>> d;
+
+public:
+    explicit
+    pipelined_sender(std::shared_ptr<basic_pipeline_t<worker_session_t>> d);
+
+    pipelined_sender(const pipelined_sender& other) = delete;
+    pipelined_sender(pipelined_sender&& other) = default;
+
+    /// Destroys this sender, closing the associated channel if it wasn't closed before.
+    ~pipelined_sender();
+
+    auto operator=(const pipelined_sender& other) -> pipelined_sender& = delete;
+    auto operator=(pipelined_sender&& other) -> pipelined_sender& = default;
+
+    /// Writes the provided message into the associated channel.
+    ///
+    /// The message is split into several chunks if it's larger than the window slice size.
+    ///
+    /// \returns a future, which is set when there is room for the next chunk in the window.
+    auto write(std::string message) -> task<void>::future_type;
+
+    /// Writes the message gathered from the given buffers without concatenating them first.
+    auto write(const buffers_t& buffers) -> task<void>::future_type;
+
+    /// Sends an error after all previously written chunks.
+    ///
+    /// \warning this sender will be invalidated after this call.
+    auto error(int ec, std::string reason) -> task<void>::future_type;
+    auto error(std::error_code ec, std::string reason) -> task<void>::future_type;
+
+    /// Closes the channel after all previously written chunks.
+    ///
+    /// \warning this sender will be invalidated after this call.
+    auto close() -> task<void>::future_type;
+
+    /// Returns a future, which is set when all chunks written so far are sent.
+    auto flush() -> task<void>::future_type;
 };
 
 }  // namespace worker
@@ -27,6 +27,7 @@
 #include "cocaine/framework/detail/log.hpp"
 #include "cocaine/framework/detail/loop.hpp"
 #include "cocaine/framework/detail/net.hpp"
+#include "cocaine/framework/detail/recycle.hpp"
 #include "cocaine/framework/detail/shared_state.hpp"
 
 #include <cocaine/trace/trace.hpp>
@@ -37,6 +38,14 @@ using namespace cocaine;
 using namespace cocaine::framework;
 using namespace cocaine::framework::detail;
 
+namespace {
+
+/// Channel frames larger than this are written one at a time, letting smaller frames go in
+/// between.
+const std::size_t BULK_FRAME_SIZE = 64 * 1024;
+
+} // namespace
+
 /// \note single shot.
 class basic_session_t::push_t:
     public std::enable_shared_from_this<push_t>
@@ -49,16 +58,34 @@ class basic_session_t::push_t:
     promise<void> pr;
 
 public:
+    /// Channel span the frame belongs to.
+    const std::uint64_t span;
+
+    /// Whether the frame is written through the bulk queue.
+    bool bulk;
+
     push_t(io::encoder_t::message_type&& message,
            std::shared_ptr<basic_session_t> session,
-           promise<void>&& pr) :
+           promise<void>&& pr,
+           std::uint64_t span) :
         message(std::move(message)),
         session(std::move(session)),
-        pr(std::move(pr))
+        pr(std::move(pr)),
+        span(span),
+        bulk(false)
     {}
 
+    auto size() const -> std::size_t {
+        return message.size();
+    }
+
     void
     operator()(std::shared_ptr<transport_type> transport) {
+        if (!transport) {
+            complete(asio::error::not_connected);
+            return;
+        }
+
         CF_DBG("writing message ...");
 
         transport->writer->write(
@@ -74,6 +101,18 @@ private:
 
         if (ec) {
             session->on_error(ec);
+        }
+
+        complete(ec);
+    }
+
+    void
+    complete(const std::error_code& ec) {
+        if (bulk) {
+            session->on_bulk(span);
+        }
+
+        if (ec) {
             pr.set_exception(std::system_error(ec));
         } else {
             pr.set_value();
@@ -87,7 +126,8 @@ basic_session_t::basic_session_t(scheduler_t& scheduler) noexcept :
     state(0),
     counter(1),
     message(boost::none),
-    hard_shutdown_(false)
+    hard_shutdown_(false),
+    latency_(0)
 {}
 
 basic_session_t::~basic_session_t() {}
@@ -162,8 +202,7 @@ auto basic_session_t::hard_shutdown(bool policy) -> void {
 
 boost::optional<basic_session_t::endpoint_type>
 basic_session_t::endpoint() const {
-    // TODO: Implement `basic_session_t::endpoint()`.
-    return boost::none;
+    return *peer.synchronize();
 }
 
 basic_session_t::native_handle_type
@@ -171,6 +210,14 @@ basic_session_t::native_handle() const {
     return (*transport.synchronize())->socket->native_handle();
 }
 
+auto basic_session_t::inflight() const -> std::size_t {
+    return channels->size();
+}
+
+auto basic_session_t::latency() const noexcept -> std::chrono::microseconds {
+    return std::chrono::microseconds(latency_.load());
+}
+
 void
 basic_session_t::cancel() {
     CF_DBG(">> disconnecting ...");
@@ -185,7 +232,7 @@ basic_session_t::cancel() {
 }
 
 framework::future<basic_session_t::invoke_result>
-basic_session_t::invoke(encode_callback_t encode_callback) {
+basic_session_t::invoke(encode_ref_t encode_callback) {
     // Synchronization here is required to prevent channel id mixing in multi-threaded environment.
     std::lock_guard<std::mutex> lock(mutex);
 
@@ -194,18 +241,75 @@ basic_session_t::invoke(encode_callback_t encode_callback) {
     CF_CTX("bI" + std::to_string(span));
     CF_DBG("invoking span %llu event ...", CF_US(span));
 
-    auto tx    = std::make_shared<basic_sender_t<basic_session_t>>(span, shared_from_this());
-    auto state = std::make_shared<shared_state_t>();
-    auto rx    = std::make_shared<basic_receiver_t<basic_session_t>>(span, shared_from_this(), state);
+    const recycling_allocator<void> allocator;
+
+    auto tx    = std::allocate_shared<basic_sender_t<basic_session_t>>(allocator, span, shared_from_this());
+    auto state = std::allocate_shared<shared_state_t>(allocator);
+    auto rx    = std::allocate_shared<basic_receiver_t<basic_session_t>>(allocator, span, shared_from_this(), state);
 
-    channels->insert(std::make_pair(span, std::move(state)));
+    channels->insert(std::make_pair(span, channel_t{ std::move(state), std::chrono::steady_clock::now() }));
     return push(encode_callback(span))
-        .then(scheduler, trace::wrap([tx, rx](future<void>& fr) -> invoke_result {
+        .then(trace::wrap([tx, rx](future<void>& fr) -> invoke_result {
             fr.get();
             return std::make_tuple(tx, rx);
         }));
 }
 
+std::vector<framework::future<basic_session_t::invoke_result>>
+basic_session_t::invoke(std::size_t size, batch_encode_ref_t encode_callback) {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    const auto first = counter.fetch_add(size);
+
+    CF_CTX("bI" + std::to_string(first));
+    CF_DBG("invoking spans [%llu, %llu) events ...", CF_US(first), CF_US(first + size));
+
+    std::vector<std::tuple<std::shared_ptr<basic_sender_t<basic_session_t>>, std::shared_ptr<basic_receiver_t<basic_session_t>>>> batch;
+    batch.reserve(size);
+
+    {
+        const auto now = std::chrono::steady_clock::now();
+
+        auto channels = this->channels.synchronize();
+        channels->reserve(channels->size() + size);
+
+        for (std::size_t id = 0; id < size; ++id) {
+            const auto span = first + id;
+
+            auto state = std::make_shared<shared_state_t>();
+            batch.emplace_back(
+                std::make_shared<basic_sender_t<basic_session_t>>(span, shared_from_this()),
+                std::make_shared<basic_receiver_t<basic_session_t>>(span, shared_from_this(), state)
+            );
+
+            channels->insert(std::make_pair(span, channel_t{ std::move(state), now }));
+        }
+    }
+
+    std::vector<future<invoke_result>> futures;
+    futures.reserve(size);
+
+    for (std::size_t id = 0; id < size; ++id) {
+        auto result = std::move(batch[id]);
+
+        framework::future<void> written;
+        try {
+            written = push(encode_callback(first + id, id));
+        } catch (...) {
+            // The receiver revokes the channel on destruction.
+            futures.push_back(make_ready_future<invoke_result>::error(std::current_exception()));
+            continue;
+        }
+
+        futures.push_back(written.then(trace::wrap([result](framework::future<void>& fr) -> invoke_result {
+            fr.get();
+            return result;
+        })));
+    }
+
+    return futures;
+}
+
 framework::future<void>
 basic_session_t::push(io::encoder_t::message_type&& message) {
     CF_CTX("bP");
@@ -214,15 +318,99 @@ basic_session_t::push(io::encoder_t::message_type&& message) {
     promise<void> pr;
     auto fr = pr.get_future();
 
+    schedule(std::allocate_shared<push_t>(
+        recycling_allocator<push_t>(), std::move(message), shared_from_this(), std::move(pr), 0
+    ), true);
+
+    return fr;
+}
+
+framework::future<void>
+basic_session_t::push(std::uint64_t span, io::encoder_t::message_type&& message) {
+    CF_CTX("bP");
+    CF_DBG(">> writing span %llu message ...", CF_US(span));
+
+    promise<void> pr;
+    auto fr = pr.get_future();
+
+    schedule(std::allocate_shared<push_t>(
+        recycling_allocator<push_t>(), std::move(message), shared_from_this(), std::move(pr), span
+    ), false);
+
+    return fr;
+}
+
+void
+basic_session_t::schedule(std::shared_ptr<push_t> pusher, bool urgent) {
+    {
+        auto outbound = this->outbound.synchronize();
+
+        // Frames of a channel having bulk frames queued follow them to keep the channel order.
+        if (!urgent && (pusher->size() > BULK_FRAME_SIZE || outbound->pending.count(pusher->span) > 0)) {
+            pusher->bulk = true;
+            ++outbound->pending[pusher->span];
+
+            if (outbound->busy) {
+                outbound->bulk.push_back(std::move(pusher));
+                return;
+            }
+
+            outbound->busy = true;
+        } else if (outbound->busy) {
+            outbound->urgent.push_back(std::move(pusher));
+            return;
+        }
+    }
+
+    write(std::move(pusher));
+}
+
+void
+basic_session_t::write(std::shared_ptr<push_t> pusher) {
     auto transport = *this->transport.synchronize();
-    if (transport) {
-        auto pusher = std::make_shared<push_t>(std::move(message), shared_from_this(), std::move(pr));
-        (*pusher)(transport);
-    } else {
-        pr.set_exception(std::system_error(asio::error::not_connected));
+    (*pusher)(std::move(transport));
+}
+
+void
+basic_session_t::on_bulk(std::uint64_t span) {
+    {
+        auto outbound = this->outbound.synchronize();
+
+        auto it = outbound->pending.find(span);
+        if (--it->second == 0) {
+            outbound->pending.erase(it);
+        }
     }
 
-    return fr;
+    // Frames queued while the bulk frame was being written go first, then the next bulk frame.
+    // The session stays busy meanwhile, so concurrently pushed frames are queued behind them.
+    while (true) {
+        std::deque<std::shared_ptr<push_t>> urgent;
+        std::shared_ptr<push_t> bulk;
+
+        {
+            auto outbound = this->outbound.synchronize();
+
+            if (!outbound->urgent.empty()) {
+                urgent.swap(outbound->urgent);
+            } else if (!outbound->bulk.empty()) {
+                bulk = std::move(outbound->bulk.front());
+                outbound->bulk.pop_front();
+            } else {
+                outbound->busy = false;
+                return;
+            }
+        }
+
+        for (auto& pusher : urgent) {
+            write(std::move(pusher));
+        }
+
+        if (bulk) {
+            write(std::move(bulk));
+            return;
+        }
+    }
 }
 
 void
@@ -253,6 +441,12 @@ basic_session_t::on_connect(const std::error_code& ec, promise<std::error_code>
         CF_CTX("bR");
         CF_DBG(">> listening for read events ...");
 
+        std::error_code error;
+        const auto endpoint = socket->remote_endpoint(error);
+        if (!error) {
+            *peer.synchronize() = endpoint_cast(endpoint);
+        }
+
         state = static_cast<std::uint8_t>(state_t::connected);
         auto transport = this->transport.synchronize();
         transport->reset(new transport_type(std::move(socket)));
@@ -277,9 +471,15 @@ basic_session_t::on_read(const std::error_code& ec) {
          if (it == channels.end()) {
              CF_DBG("dropping an orphan span %llu message", CF_US(message.span()));
              return nullptr;
-         } else {
-             return it->second;
          }
+
+         auto& birth = it->second.birth;
+         if (birth != std::chrono::steady_clock::time_point()) {
+             observe(std::chrono::steady_clock::now() - birth);
+             birth = std::chrono::steady_clock::time_point();
+         }
+
+         return it->second.state;
     });
 
     if (state) {
@@ -305,7 +505,7 @@ basic_session_t::on_error(const std::error_code& ec) {
     });
 
     for (auto channel : channels) {
-        channel.second->put(ec);
+        channel.second.state->put(ec);
     }
 }
 
@@ -319,8 +519,18 @@ basic_session_t::pull(std::shared_ptr<transport_type> transport) {
     );
 }
 
+void
+basic_session_t::observe(std::chrono::steady_clock::duration elapsed) {
+    const std::uint64_t sample = std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count();
+
+    // Reads are serialized by the transport, so there are no concurrent writers here.
+    const auto current = latency_.load();
+    latency_ = current == 0 ? sample : (current * 7 + sample) / 8;
+}
+
 #include "sender.cpp"
 template class cocaine::framework::basic_sender_t<basic_session_t>;
+template class cocaine::framework::basic_pipeline_t<basic_session_t>;
 
 #include "receiver.cpp"
 template class cocaine::framework::basic_receiver_t<basic_session_t>;
@@ -0,0 +1,115 @@
+/*
+    Copyright (c) 2015 Evgeny Safronov <division494@gmail.com>
+    Copyright (c) 2011-2015 Other contributors as noted in the AUTHORS file.
+    This file is part of Cocaine.
+    Cocaine is free software; you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+    Cocaine is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Lesser General Public License for more details.
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "cocaine/framework/detail/breaker.hpp"
+
+#include <algorithm>
+
+#include "cocaine/framework/detail/log.hpp"
+
+using namespace cocaine::framework;
+using namespace cocaine::framework::detail;
+
+backoff_t::backoff_t(std::chrono::milliseconds base, std::chrono::milliseconds cap) :
+    base(base),
+    cap(std::max(base, cap)),
+    attempt(0)
+{}
+
+auto backoff_t::next(std::minstd_rand& random) -> std::chrono::milliseconds {
+    // Stop doubling long before overflow, the cap is reached much earlier anyway.
+    const auto shift = std::min<std::uint32_t>(attempt++, 30);
+    const auto delay = std::min<std::int64_t>(base.count() << shift, cap.count());
+
+    std::uniform_int_distribution<std::int64_t> distribution(delay / 2, delay);
+    return std::chrono::milliseconds(distribution(random));
+}
+
+auto backoff_t::attempts() const noexcept -> std::uint32_t {
+    return attempt;
+}
+
+void
+backoff_t::reset() noexcept {
+    attempt = 0;
+}
+
+circuit_breaker_t::circuit_breaker_t(const service_options_t& options) :
+    threshold(options.threshold),
+    state_(state_t::closed),
+    failures(0),
+    backoff(options.quarantine, options.backoff),
+    random(std::random_device()())
+{}
+
+auto circuit_breaker_t::state() const -> state_t {
+    std::lock_guard<std::mutex> lock(mutex);
+    return state_;
+}
+
+auto circuit_breaker_t::allow() -> bool {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    switch (state_) {
+    case state_t::closed:
+        return true;
+    case state_t::open:
+        if (std::chrono::steady_clock::now() < deadline) {
+            return false;
+        }
+
+        CF_DBG("circuit is half-open, probing");
+        state_ = state_t::half_open;
+        return true;
+    case state_t::half_open:
+        return false;
+    }
+
+    return false;
+}
+
+void
+circuit_breaker_t::success() {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    if (state_ != state_t::closed) {
+        CF_DBG("circuit is closed");
+    }
+
+    state_ = state_t::closed;
+    failures = 0;
+    backoff.reset();
+}
+
+void
+circuit_breaker_t::failure() {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    ++failures;
+
+    if (threshold == 0 || state_ == state_t::open) {
+        return;
+    }
+
+    if (state_ == state_t::half_open || failures >= threshold) {
+        const auto period = backoff.next(random);
+        CF_DBG("circuit is open for %lld ms after %llu failures",
+               static_cast<long long>(period.count()), CF_US(failures));
+
+        state_ = state_t::open;
+        deadline = std::chrono::steady_clock::now() + period;
+    }
+}
@@ -0,0 +1,151 @@
+/*
+    Copyright (c) 2015 Evgeny Safronov <division494@gmail.com>
+    Copyright (c) 2011-2015 Other contributors as noted in the AUTHORS file.
+    This file is part of Cocaine.
+    Cocaine is free software; you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+    Cocaine is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Lesser General Public License for more details.
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "cocaine/framework/service/cache.hpp"
+
+#include <iterator>
+
+using namespace cocaine::framework;
+using namespace cocaine::framework::detail;
+
+response_cache_t::response_cache_t(cache_options_t options) :
+    options(std::move(options)),
+    bytes(0),
+    hits(0),
+    misses(0)
+{}
+
+auto response_cache_t::ttl(int id) const -> std::chrono::milliseconds {
+    const auto it = options.ttls.find(id);
+    if (it == options.ttls.end()) {
+        return options.ttl;
+    }
+
+    return it->second;
+}
+
+auto response_cache_t::get(const std::string& key) -> boost::optional<std::string> {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    auto it = index.find(key);
+    if (it == index.end()) {
+        ++misses;
+        return boost::none;
+    }
+
+    if (it->second->expires <= std::chrono::steady_clock::now()) {
+        erase(it->second);
+        ++misses;
+        return boost::none;
+    }
+
+    entries.splice(entries.begin(), entries, it->second);
+    ++hits;
+    return it->second->value;
+}
+
+auto response_cache_t::begin(const std::string& key) -> std::uint64_t {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    auto& current = pending[key];
+    ++current.count;
+    return current.generation;
+}
+
+void
+response_cache_t::put(const std::string& key, std::string value, std::chrono::milliseconds ttl, std::uint64_t generation) {
+    entry_t entry{ key, std::move(value), std::chrono::steady_clock::now() + ttl };
+    const auto size = entry.size();
+
+    std::lock_guard<std::mutex> lock(mutex);
+
+    if (!finish(key, generation) || ttl.count() <= 0 || size > options.capacity) {
+        return;
+    }
+
+    auto it = index.find(key);
+    if (it != index.end()) {
+        erase(it->second);
+    }
+
+    while (!entries.empty() && bytes + size > options.capacity) {
+        erase(std::prev(entries.end()));
+    }
+
+    entries.push_front(std::move(entry));
+    index[key] = entries.begin();
+    bytes += size;
+}
+
+void
+response_cache_t::cancel(const std::string& key) {
+    std::lock_guard<std::mutex> lock(mutex);
+    finish(key, 0);
+}
+
+void
+response_cache_t::erase(const std::string& key) {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    auto current = pending.find(key);
+    if (current != pending.end()) {
+        ++current->second.generation;
+    }
+
+    auto it = index.find(key);
+    if (it != index.end()) {
+        erase(it->second);
+    }
+}
+
+void
+response_cache_t::clear() {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    for (auto& current : pending) {
+        ++current.second.generation;
+    }
+
+    entries.clear();
+    index.clear();
+    bytes = 0;
+}
+
+auto response_cache_t::stats() const -> cache_stats_t {
+    std::lock_guard<std::mutex> lock(mutex);
+    return cache_stats_t{ hits, misses, entries.size(), bytes };
+}
+
+void
+response_cache_t::erase(list_type::iterator it) {
+    bytes -= it->size();
+    index.erase(it->key);
+    entries.erase(it);
+}
+
+auto response_cache_t::finish(const std::string& key, std::uint64_t generation) -> bool {
+    auto it = pending.find(key);
+    if (it == pending.end()) {
+        return false;
+    }
+
+    const bool current = it->second.generation == generation;
+    if (--it->second.count == 0) {
+        pending.erase(it);
+    }
+
+    return current;
+}
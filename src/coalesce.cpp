@@ -0,0 +1,44 @@
+/*
+    Copyright (c) 2015 Evgeny Safronov <division494@gmail.com>
+    Copyright (c) 2011-2015 Other contributors as noted in the AUTHORS file.
+    This file is part of Cocaine.
+    Cocaine is free software; you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+    Cocaine is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Lesser General Public License for more details.
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "cocaine/framework/service/coalesce.hpp"
+
+using namespace cocaine::framework;
+using namespace cocaine::framework::detail;
+
+basic_flight_t::~basic_flight_t() {}
+
+auto flight_map_t::insert(const std::string& key, std::shared_ptr<basic_flight_t> flight)
+    -> std::shared_ptr<basic_flight_t>
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return flights.insert(std::make_pair(key, std::move(flight))).first->second;
+}
+
+void
+flight_map_t::erase(const std::string& key, const std::shared_ptr<basic_flight_t>& flight) {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    auto it = flights.find(key);
+    if (it != flights.end() && it->second == flight) {
+        flights.erase(it);
+    }
+}
+
+auto flight_map_t::size() -> std::size_t {
+    std::lock_guard<std::mutex> lock(mutex);
+    return flights.size();
+}
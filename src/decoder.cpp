@@ -17,6 +17,7 @@
 #include "cocaine/framework/detail/decoder.hpp"
 
 #include <memory>
+#include <string>
 
 #include <msgpack/object.hpp>
 #include <msgpack/unpack.hpp>
@@ -32,8 +33,45 @@
 
 #include "cocaine/framework/message.hpp"
 
+#include "cocaine/framework/detail/deflate.hpp"
+
 using namespace cocaine::framework::detail;
 
+namespace {
+
+/// Encodes the message with its single compressed string argument replaced by the decompressed
+/// one into the given buffer.
+bool
+decompress(const msgpack::object& object, std::vector<char>& result) {
+    const auto& args = object.via.array.ptr[2];
+    if(args.via.array.size != 1 || args.via.array.ptr[0].type != msgpack::type::RAW) {
+        return false;
+    }
+
+    const auto& raw = args.via.array.ptr[0].via.raw;
+
+    std::string payload;
+    try {
+        payload = inflate(raw.ptr, raw.size);
+    } catch(const std::exception&) {
+        return false;
+    }
+
+    msgpack::sbuffer buffer;
+    msgpack::packer<msgpack::sbuffer> packer(buffer);
+    packer.pack_array(3);
+    packer << object.via.array.ptr[0];
+    packer << object.via.array.ptr[1];
+    packer.pack_array(1);
+    packer.pack_raw(payload.size());
+    packer.pack_raw_body(payload.data(), payload.size());
+
+    result.assign(buffer.data(), buffer.data() + buffer.size());
+    return true;
+}
+
+} // namespace
+
 size_t decoder_t::decode(const char* data, size_t size, message_type& message, std::error_code& ec) {
     size_t offset = 0;
 
@@ -55,6 +93,18 @@ size_t decoder_t::decode(const char* data, size_t size, message_type& message, s
             error = error || !hpack::msgpack_traits::unpack_vector(object.via.array.ptr[3], header_table, headers);
         }
         if(error) {
+            ec = error::frame_format_error;
+        } else if(compressed(headers)) {
+            // Headers refer to the original buffer, so the message keeps it alongside the inflated
+            // one.
+            std::vector<char> inflated;
+            if(decompress(object, inflated)) {
+                size_t unused = 0;
+                msgpack::unpack(inflated.data(), inflated.size(), &unused, &zone, &object);
+                message = message_type(std::move(object), std::move(inflated), std::move(buffer), std::move(headers));
+                return offset;
+            }
+
             ec = error::frame_format_error;
         }
         message = message_type(std::move(object), std::move(buffer), std::move(headers));
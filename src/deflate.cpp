@@ -0,0 +1,139 @@
+/*
+    Copyright (c) 2015 Evgeny Safronov <division494@gmail.com>
+    Copyright (c) 2011-2015 Other contributors as noted in the AUTHORS file.
+    This file is part of Cocaine.
+    Cocaine is free software; you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+    Cocaine is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Lesser General Public License for more details.
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "cocaine/framework/detail/deflate.hpp"
+
+#include <stdexcept>
+
+#include <zlib.h>
+
+#include <cocaine/hpack/msgpack_traits.hpp>
+
+#include "cocaine/framework/encoder.hpp"
+
+using namespace cocaine;
+using namespace cocaine::framework;
+using namespace cocaine::framework::detail;
+
+namespace {
+
+/// Encodes the event with a single compressed string argument and the content encoding header.
+struct deflated_t : public io::encoder_t::message_type {
+    deflated_t(std::uint64_t span, int id, const std::string& payload) {
+        const std::vector<hpack::header_t> headers{{
+            hpack::header_t(content_encoding::name(), content_encoding::deflate())
+        }};
+
+        msgpack::packer<buffer_type> packer(buffer);
+        packer.pack_array(4);
+        packer.pack(span);
+        packer.pack(id);
+        packer.pack_array(1);
+        packer.pack_raw(payload.size());
+        packer.pack_raw_body(payload.data(), payload.size());
+
+        // Headers are packed using a fresh table, so they never refer to entries of the dynamic
+        // table, which wouldn't survive frames being written in other order than encoded.
+        hpack::header_table_t table;
+        hpack::msgpack_traits::pack_vector(packer, table, headers);
+    }
+};
+
+} // namespace
+
+auto content_encoding::name() -> const hpack::header::data_t& {
+    static const hpack::header::data_t data = { "content-encoding", 16 };
+    return data;
+}
+
+auto content_encoding::deflate() -> const hpack::header::data_t& {
+    static const hpack::header::data_t data = { "deflate", 7 };
+    return data;
+}
+
+auto detail::compressed(const std::vector<hpack::header_t>& headers) -> bool {
+    for (const auto& header : headers) {
+        if (header.get_name() == content_encoding::name()) {
+            return header.get_value() == content_encoding::deflate();
+        }
+    }
+
+    return false;
+}
+
+auto detail::deflate(const char* data, std::size_t size, int level) -> std::string {
+    uLongf length = compressBound(size);
+    std::string result(length, '\0');
+
+    const auto rc = compress2(
+        reinterpret_cast<Bytef*>(&result[0]), &length, reinterpret_cast<const Bytef*>(data), size, level
+    );
+
+    if (rc != Z_OK) {
+        throw std::runtime_error("failed to compress payload");
+    }
+
+    result.resize(length);
+    return result;
+}
+
+auto detail::inflate(const char* data, std::size_t size, std::size_t limit) -> std::string {
+    z_stream stream = z_stream();
+    if (inflateInit(&stream) != Z_OK) {
+        throw std::runtime_error("failed to initialize decompression");
+    }
+
+    stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data));
+    stream.avail_in = size;
+
+    std::string result;
+    char chunk[16 * 1024];
+
+    int rc = Z_OK;
+    while (rc == Z_OK) {
+        stream.next_out = reinterpret_cast<Bytef*>(chunk);
+        stream.avail_out = sizeof(chunk);
+
+        rc = ::inflate(&stream, Z_NO_FLUSH);
+
+        const std::size_t produced = sizeof(chunk) - stream.avail_out;
+        if (produced > limit - result.size()) {
+            inflateEnd(&stream);
+            throw std::runtime_error("failed to decompress payload: size limit exceeded");
+        }
+
+        result.append(chunk, produced);
+
+        if (rc == Z_BUF_ERROR && stream.avail_in == 0) {
+            break;
+        }
+    }
+
+    inflateEnd(&stream);
+
+    if (rc != Z_STREAM_END) {
+        throw std::runtime_error("failed to decompress payload: corrupted data");
+    }
+
+    return result;
+}
+
+auto detail::deflated(std::uint64_t span, int id, const char* data, std::size_t size, int level) ->
+    io::encoder_t::message_type
+{
+    return deflated_t(span, id, deflate(data, size, level));
+}
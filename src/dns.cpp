@@ -0,0 +1,196 @@
+/*
+    Copyright (c) 2015 Evgeny Safronov <division494@gmail.com>
+    Copyright (c) 2011-2015 Other contributors as noted in the AUTHORS file.
+    This file is part of Cocaine.
+    Cocaine is free software; you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+    Cocaine is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Lesser General Public License for more details.
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "cocaine/framework/detail/dns.hpp"
+
+#include <algorithm>
+#include <system_error>
+
+#include <asio/error.hpp>
+
+#include <boost/lexical_cast.hpp>
+
+#include "cocaine/framework/detail/log.hpp"
+#include "cocaine/framework/detail/net.hpp"
+
+namespace ph = std::placeholders;
+
+using namespace cocaine::framework;
+using namespace cocaine::framework::detail;
+
+namespace {
+
+/// Bounds of the delay before retrying a round that has resolved no endpoints.
+const std::chrono::milliseconds RETRY_BASE(500);
+const std::chrono::milliseconds RETRY_CAP(30000);
+
+} // namespace
+
+dns_resolver_t::dns_resolver_t(std::vector<host_type> hosts, loop_t& loop, std::chrono::milliseconds interval) :
+    loop(loop),
+    hosts(std::move(hosts)),
+    interval(interval),
+    resolved(this->hosts.size()),
+    // There is nothing to wait for without hosts.
+    ready(this->hosts.empty()),
+    stopped(false),
+    pending(0),
+    timer(loop),
+    backoff(RETRY_BASE, interval.count() > 0 ? std::min(interval, RETRY_CAP) : RETRY_CAP),
+    random(std::random_device()())
+{}
+
+void
+dns_resolver_t::start() {
+    std::lock_guard<std::mutex> lock(mutex);
+    resolve();
+}
+
+void
+dns_resolver_t::stop() {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    stopped = true;
+    timer.cancel();
+
+    for (const auto& lookup : lookups) {
+        lookup->cancel();
+    }
+}
+
+auto dns_resolver_t::current() const -> std::vector<endpoint_type> {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    if (!ready) {
+        return std::vector<endpoint_type>();
+    }
+
+    return flatten();
+}
+
+auto dns_resolver_t::endpoints() -> task<std::vector<endpoint_type>>::future_type {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    if (ready) {
+        return make_ready_future<std::vector<endpoint_type>>::value(flatten());
+    }
+
+    task<std::vector<endpoint_type>>::promise_type promise;
+    auto future = promise.get_future();
+    waiting.push_back(std::move(promise));
+    return future;
+}
+
+void
+dns_resolver_t::resolve() {
+    if (stopped || hosts.empty()) {
+        return;
+    }
+
+    CF_DBG(">> resolving %llu locator hosts ...", CF_US(hosts.size()));
+
+    lookups.clear();
+    pending = hosts.size();
+
+    // All lookups are started at once, so the round takes as long as the slowest one.
+    for (std::size_t id = 0; id < hosts.size(); ++id) {
+        const asio::ip::tcp::resolver::query query(
+            std::get<0>(hosts[id]),
+            boost::lexical_cast<std::string>(std::get<1>(hosts[id])),
+            asio::ip::tcp::resolver::query::numeric_service
+        );
+
+        auto lookup = std::make_shared<asio::ip::tcp::resolver>(loop);
+        lookup->async_resolve(query, std::bind(&dns_resolver_t::on_resolve, shared_from_this(), ph::_1, ph::_2, id));
+        lookups.push_back(std::move(lookup));
+    }
+}
+
+void
+dns_resolver_t::on_resolve(const std::error_code& ec, asio::ip::tcp::resolver::iterator it, std::size_t id) {
+    std::unique_lock<std::mutex> lock(mutex);
+
+    if (ec) {
+        CF_DBG("<< failed to resolve '%s': %s", std::get<0>(hosts[id]).c_str(), ec.message().c_str());
+    } else {
+        std::vector<endpoint_type> endpoints;
+        for (asio::ip::tcp::resolver::iterator end; it != end; ++it) {
+            endpoints.push_back(endpoint_cast(it->endpoint()));
+        }
+
+        resolved[id] = std::move(endpoints);
+    }
+
+    if (--pending > 0) {
+        return;
+    }
+
+    lookups.clear();
+
+    const auto endpoints = flatten();
+    CF_DBG("<< resolved %llu locator endpoints", CF_US(endpoints.size()));
+
+    // Waiters are failed by an empty round, but the resolver stays not ready until some round
+    // produces endpoints, so that the next waiters wait for it.
+    ready = ready || !endpoints.empty();
+    auto promises = std::move(waiting);
+    waiting.clear();
+
+    // Without any endpoints nothing can connect, so the round is retried soon even if
+    // re-resolving is disabled.
+    std::chrono::milliseconds delay(0);
+    if (endpoints.empty()) {
+        delay = backoff.next(random);
+    } else {
+        backoff.reset();
+        delay = interval;
+    }
+
+    if (!stopped && delay.count() > 0) {
+        CF_DBG("next round of resolving in %llu ms", CF_US(delay.count()));
+        timer.expires_from_now(boost::posix_time::milliseconds(delay.count()));
+        timer.async_wait(std::bind(&dns_resolver_t::on_timer, shared_from_this(), ph::_1));
+    }
+
+    lock.unlock();
+
+    for (auto& promise : promises) {
+        if (endpoints.empty()) {
+            promise.set_exception(std::system_error(asio::error::host_not_found));
+        } else {
+            promise.set_value(endpoints);
+        }
+    }
+}
+
+void
+dns_resolver_t::on_timer(const std::error_code& ec) {
+    if (ec) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    resolve();
+}
+
+auto dns_resolver_t::flatten() const -> std::vector<endpoint_type> {
+    std::vector<endpoint_type> result;
+    for (const auto& endpoints : resolved) {
+        result.insert(result.end(), endpoints.begin(), endpoints.end());
+    }
+
+    return result;
+}
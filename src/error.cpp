@@ -41,6 +41,7 @@ static const error_category_registrator_t registrator = error_category_registrat
 
 /// Extended description formatting patterns.
 static const char ERROR_SERVICE_NOT_FOUND[] = "the service '{}' is not available";
+static const char ERROR_SERVICE_UNAVAILABLE[] = "the service '{}' is temporarily unavailable";
 static const char ERROR_VERSION_MISMATCH[]  = "version mismatch ({} expected, but {} actual)";
 
 namespace {
@@ -58,6 +59,8 @@ struct service_category_t : public std::error_category {
             return "the specified service was not found in the locator";
         case static_cast<int>(cocaine::framework::error::version_mismatch):
             return "the service provides API with version different than required";
+        case static_cast<int>(cocaine::framework::error::service_unavailable):
+            return "the service is temporarily unavailable due to repeated connection failures";
         default:
             return "unexpected service error";
         }
@@ -127,6 +130,17 @@ const std::string& service_not_found::name() const noexcept {
     return name_;
 }
 
+service_unavailable::service_unavailable(const std::string& name) :
+    error_t(error::service_unavailable, cocaine::format(ERROR_SERVICE_UNAVAILABLE, name)),
+    name_(name)
+{}
+
+service_unavailable::~service_unavailable() noexcept {}
+
+const std::string& service_unavailable::name() const noexcept {
+    return name_;
+}
+
 version_mismatch::version_mismatch(int expected, int actual) :
     error_t(error::version_mismatch, cocaine::format(ERROR_VERSION_MISMATCH, expected, actual)),
     expected_(expected),
@@ -0,0 +1,104 @@
+/*
+    Copyright (c) 2015 Evgeny Safronov <division494@gmail.com>
+    Copyright (c) 2011-2015 Other contributors as noted in the AUTHORS file.
+    This file is part of Cocaine.
+    Cocaine is free software; you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+    Cocaine is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Lesser General Public License for more details.
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "cocaine/framework/service/hedge.hpp"
+
+using namespace cocaine::framework;
+using namespace cocaine::framework::detail;
+
+basic_race_t::basic_race_t() :
+    started(0),
+    failed(0),
+    done(false),
+    primary_(nullptr)
+{}
+
+auto basic_race_t::start() -> bool {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    if (done) {
+        return false;
+    }
+
+    ++started;
+    return true;
+}
+
+auto basic_race_t::completed() const -> bool {
+    std::lock_guard<std::mutex> lock(mutex);
+    return done;
+}
+
+void
+basic_race_t::assign(const session_t* session) {
+    std::lock_guard<std::mutex> lock(mutex);
+    primary_ = session;
+}
+
+auto basic_race_t::primary() const -> const session_t* {
+    std::lock_guard<std::mutex> lock(mutex);
+    return primary_;
+}
+
+auto basic_race_t::track(std::function<void()> revoker) -> bool {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    if (done) {
+        return false;
+    }
+
+    revokers.push_back(std::move(revoker));
+    return true;
+}
+
+auto basic_race_t::finish() -> bool {
+    std::unique_lock<std::mutex> lock(mutex);
+
+    if (done) {
+        return false;
+    }
+
+    done = true;
+    auto revokers = std::move(this->revokers);
+    lock.unlock();
+
+    // Revoked channels fail their pending operations, which may reenter this object.
+    for (const auto& revoke : revokers) {
+        revoke();
+    }
+
+    return true;
+}
+
+auto basic_race_t::fail() -> bool {
+    std::unique_lock<std::mutex> lock(mutex);
+
+    ++failed;
+
+    if (done || failed < started) {
+        return false;
+    }
+
+    done = true;
+    auto revokers = std::move(this->revokers);
+    lock.unlock();
+
+    for (const auto& revoke : revokers) {
+        revoke();
+    }
+
+    return true;
+}
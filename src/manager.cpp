@@ -16,7 +16,9 @@
 
 #include "cocaine/framework/manager.hpp"
 
-#include <boost/lexical_cast.hpp>
+#include <map>
+#include <mutex>
+
 #include <boost/optional/optional.hpp>
 #include <boost/thread/thread.hpp>
 
@@ -25,7 +27,9 @@
 #include "cocaine/framework/scheduler.hpp"
 #include "cocaine/framework/service.hpp"
 
+#include "cocaine/framework/detail/dns.hpp"
 #include "cocaine/framework/detail/loop.hpp"
+#include "cocaine/framework/detail/resolver.hpp"
 #include "cocaine/framework/detail/runnable.hpp"
 
 namespace io {
@@ -65,6 +69,9 @@ static const std::vector<session_t::endpoint_type> DEFAULT_LOCATIONS = {
     { boost::asio::ip::tcp::v6(), 10053 }
 };
 
+/// How often Locator host names are resolved again.
+static const std::chrono::milliseconds DNS_REFRESH_INTERVAL(60000);
+
 class cocaine::framework::service_manager_data {
 public:
     loop_t io;
@@ -74,50 +81,77 @@ public:
 
     std::vector<session_t::endpoint_type> locations;
 
+    /// Resolves Locator host names if the manager has been constructed with them.
+    std::shared_ptr<dns_resolver_t> hosts;
+
     std::vector<boost::thread> threads;
 
+    /// The Locator session shared by all resolvers, created along with the first of them.
+    std::shared_ptr<resolver_t::locators_t> locators;
+
     std::shared_ptr<service<io::log_tag>> logger;
 
+    /// Resolves all registered services over a single Locator connection.
+    std::shared_ptr<serialized_resolver_t> resolver;
+
+    /// Services shared between handles, keyed by name and protocol version.
+    std::map<std::tuple<std::string, uint>, std::shared_ptr<basic_service_t>> services;
+    std::mutex mutex;
+
+    explicit
     service_manager_data(std::vector<session_t::endpoint_type> locations_) :
         work(boost::optional<loop_t::work>(loop_t::work(io))),
         event_loop(io),
         scheduler(event_loop),
         locations(std::move(locations_)),
-        logger(std::make_shared<service<io::log_tag>>(internal_logger_t(), "logging", locations, scheduler))
+        logger(make_logger()),
+        resolver(make_resolver(resolve_options_t()))
     {}
-};
-
-namespace {
-
-auto resolve(std::vector<std::tuple<std::string, std::uint16_t>> endpoints) ->
-    std::vector<service_manager_t::endpoint_type>
-{
-    std::vector<service_manager_t::endpoint_type> result;
-
-    boost::asio::io_service io_service;
-    boost::asio::ip::tcp::resolver resolver(io_service);
 
-    auto inserter = std::back_inserter(result);
-
-    boost::asio::ip::tcp::resolver::iterator end;
-    std::string host;
-    std::uint16_t port;
-    for (const auto& endpoint : endpoints) {
-        std::tie(host, port) = endpoint;
+    explicit
+    service_manager_data(std::vector<std::tuple<std::string, std::uint16_t>> entries) :
+        work(boost::optional<loop_t::work>(loop_t::work(io))),
+        event_loop(io),
+        scheduler(event_loop),
+        hosts(std::make_shared<dns_resolver_t>(std::move(entries), io, DNS_REFRESH_INTERVAL)),
+        logger(make_logger()),
+        resolver(make_resolver(resolve_options_t()))
+    {
+        hosts->start();
+    }
 
-        boost::asio::ip::tcp::resolver::query query(
-            host,
-            boost::lexical_cast<std::string>(port),
-            boost::asio::ip::tcp::resolver::query::flags::numeric_service
-        );
-        const auto it = resolver.resolve(query);
-        std::copy(it, end, inserter);
+    /// Creates a resolver sharing the Locator session with all other resolvers of the manager.
+    ///
+    /// \note the first resolver is created by the constructor for the logger, so the shared
+    /// session is never assigned concurrently.
+    auto make_resolver(resolve_options_t options) -> std::shared_ptr<serialized_resolver_t> {
+        std::shared_ptr<serialized_resolver_t> resolver;
+        if (hosts) {
+            resolver = std::make_shared<serialized_resolver_t>(hosts, scheduler, std::move(options), locators);
+        } else {
+            resolver = std::make_shared<serialized_resolver_t>(locations, scheduler, std::move(options), locators);
+        }
+
+        if (!locators) {
+            locators = resolver->shared();
+        }
+
+        return resolver;
     }
 
-    return result;
-}
+private:
+    auto make_logger() -> std::shared_ptr<service<io::log_tag>> {
+        const basic_service_t logging(
+            internal_logger_t(),
+            "logging",
+            cocaine::io::protocol<io::log_tag>::version::value,
+            make_resolver(resolve_options_t()),
+            scheduler
+        );
 
-}  // namespace
+        return std::make_shared<service<io::log_tag>>(logging);
+    }
+};
 
 service_manager_t::service_manager_t() :
     d(new service_manager_data(DEFAULT_LOCATIONS))
@@ -139,7 +173,7 @@ service_manager_t::service_manager_t(std::vector<endpoint_type> entries, unsigne
 }
 
 service_manager_t::service_manager_t(std::vector<std::tuple<std::string, std::uint16_t>> entries, unsigned int threads) :
-    d(new service_manager_data(resolve(entries)))
+    d(new service_manager_data(std::move(entries)))
 {
     start(threads);
 }
@@ -149,6 +183,18 @@ service_manager_t::~service_manager_t() {
     // Otherwise they will wait forever until all asynchronous operations completes.
     d->logger.reset();
 
+    {
+        std::lock_guard<std::mutex> lock(d->mutex);
+        d->services.clear();
+    }
+
+    d->resolver.reset();
+    d->locators.reset();
+
+    if (d->hosts) {
+        d->hosts->stop();
+    }
+
     d->work.reset();
 
     for (auto& thread : d->threads) {
@@ -158,6 +204,10 @@ service_manager_t::~service_manager_t() {
 
 std::vector<session_t::endpoint_type>
 service_manager_t::endpoints() const {
+    if (d->hosts) {
+        return d->hosts->current();
+    }
+
     return d->locations;
 }
 
@@ -181,3 +231,36 @@ std::shared_ptr<service<io::log_tag>>
 service_manager_t::logger() const {
     return d->logger;
 }
+
+std::shared_ptr<basic_service_t>
+service_manager_t::shared(std::string name, uint version) {
+    std::lock_guard<std::mutex> lock(d->mutex);
+
+    auto& service = d->services[std::make_tuple(name, version)];
+    if (!service) {
+        service = std::make_shared<basic_service_t>(logger(), std::move(name), version, d->resolver, next());
+    }
+
+    return service;
+}
+
+std::shared_ptr<basic_service_t>
+service_manager_t::dedicated(std::string name, uint version, service_options_t options) {
+    auto resolver = d->make_resolver(options.resolve);
+    return std::make_shared<basic_service_t>(logger(), std::move(name), version, std::move(resolver), next(), std::move(options));
+}
+
+void
+service_manager_t::resolve_options(resolve_options_t options) {
+    d->resolver = d->make_resolver(std::move(options));
+}
+
+void
+service_manager_t::persist(const std::string& path) {
+    d->resolver->persist(path);
+}
+
+cocaine::framework::future<void>
+service_manager_t::prefetch(const std::vector<std::string>& names) {
+    return d->resolver->prefetch(names);
+}
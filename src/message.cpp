@@ -40,8 +40,23 @@ public:
         header_zone(headers)
     {}
 
+    inner_t(msgpack::object _obj,
+            std::vector<char>&& _storage,
+            std::vector<char>&& _origin,
+            std::vector<hpack::header_t> _headers) :
+        obj(std::move(_obj)),
+        storage(std::move(_storage)),
+        origin(std::move(_origin)),
+        headers(std::move(_headers)),
+        header_zone(headers)
+    {}
+
     msgpack::object obj;
     std::vector<char> storage;
+
+    /// The received buffer headers refer to, if the payload is stored elsewhere.
+    std::vector<char> origin;
+
     std::vector<hpack::header_t> headers;
     hpack::header_t::zone_t header_zone;
 };
@@ -54,6 +69,13 @@ decoded_message::decoded_message(msgpack::object obj, std::vector<char>&& storag
     d(new inner_t(std::move(obj), std::move(storage), std::move(headers)))
 {}
 
+decoded_message::decoded_message(msgpack::object obj,
+                                 std::vector<char>&& storage,
+                                 std::vector<char>&& origin,
+                                 std::vector<hpack::header_t> headers) :
+    d(new inner_t(std::move(obj), std::move(storage), std::move(origin), std::move(headers)))
+{}
+
 decoded_message::~decoded_message() = default;
 
 decoded_message::decoded_message(decoded_message&& other) = default;
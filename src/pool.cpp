@@ -0,0 +1,586 @@
+/*
+    Copyright (c) 2015 Evgeny Safronov <division494@gmail.com>
+    Copyright (c) 2011-2015 Other contributors as noted in the AUTHORS file.
+    This file is part of Cocaine.
+    Cocaine is free software; you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+    Cocaine is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Lesser General Public License for more details.
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "cocaine/framework/detail/pool.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+
+#include <boost/assert.hpp>
+
+#include <asio/error.hpp>
+
+#include "cocaine/framework/trace.hpp"
+
+#include "cocaine/framework/detail/breaker.hpp"
+#include "cocaine/framework/detail/log.hpp"
+
+namespace ph = std::placeholders;
+
+using namespace cocaine::framework;
+using namespace cocaine::framework::detail;
+
+class session_pool_t::slot_t {
+public:
+    /// Endpoints to connect to.
+    ///
+    /// \note guarded by the pool mutex.
+    std::vector<endpoint_type> endpoints;
+
+    std::shared_ptr<session_t> session;
+
+    /// Number of invocations that have selected this slot, but haven't registered their channels
+    /// in the session yet.
+    std::atomic<std::size_t> pending;
+
+    /// Time point until which this slot is excluded from routing.
+    ///
+    /// \note guarded by the pool mutex.
+    std::chrono::steady_clock::time_point quarantine;
+
+    /// Grows the quarantine period on consecutive connection failures.
+    ///
+    /// \note guarded by the pool mutex.
+    backoff_t backoff;
+
+    /// The last connection error, reported to invocations while the slot is quarantined.
+    ///
+    /// \note guarded by the pool mutex.
+    std::exception_ptr error;
+
+    slot_t(std::vector<endpoint_type> endpoints, scheduler_t& scheduler, const service_options_t& options) :
+        endpoints(std::move(endpoints)),
+        session(std::make_shared<session_t>(scheduler)),
+        pending(0),
+        backoff(options.quarantine, options.backoff)
+    {}
+
+    auto load() const -> std::size_t {
+        return pending + session->inflight();
+    }
+
+    /// Returns the expected cost of routing one more invocation through this slot.
+    ///
+    /// Sessions without latency observations are considered the fastest ones to let them warm up.
+    auto cost() const -> std::uint64_t {
+        const std::uint64_t latency = session->latency().count();
+        return (load() + 1) * std::max<std::uint64_t>(latency, 1);
+    }
+
+    auto eligible(std::chrono::steady_clock::time_point now) const -> bool {
+        return quarantine <= now;
+    }
+};
+
+namespace {
+
+/// Number of ring points per endpoint, enough to keep the key distribution even for a few endpoints.
+const std::size_t RING_POINTS = 160;
+
+/// 64-bit FNV-1a hash, which unlike `std::hash` gives the same ring in every process.
+auto fnv1a(const std::string& data) -> std::uint64_t {
+    std::uint64_t hash = 14695981039346656037ULL;
+    for (unsigned char c : data) {
+        hash ^= c;
+        hash *= 1099511628211ULL;
+    }
+
+    return hash;
+}
+
+/// Holds a slot reservation until the last copy of the selected session pointer is released.
+template<class Slot>
+class lease_t {
+    std::shared_ptr<Slot> slot;
+
+public:
+    explicit lease_t(std::shared_ptr<Slot> slot) :
+        slot(std::move(slot))
+    {
+        ++this->slot->pending;
+    }
+
+    ~lease_t() {
+        --slot->pending;
+    }
+};
+
+} // namespace
+
+session_pool_t::session_pool_t(service_options_t options_, scheduler_t& scheduler) :
+    scheduler(scheduler),
+    options(std::move(options_)),
+    assigned_(false),
+    hard_shutdown_(false),
+    counter(0),
+    random(std::random_device()())
+{
+    if (options.pool == 0) {
+        throw std::invalid_argument("session pool size must be a positive number");
+    }
+
+    if (options.bound < 1.0) {
+        throw std::invalid_argument("routing load bound must be at least one");
+    }
+
+    // In spread mode slots are created after endpoints are known.
+    if (!options.spread) {
+        slots.reserve(options.pool);
+        for (std::size_t id = 0; id < options.pool; ++id) {
+            slots.push_back(make_slot(std::vector<endpoint_type>()));
+        }
+    }
+}
+
+session_pool_t::~session_pool_t() {}
+
+auto session_pool_t::assigned() const -> bool {
+    std::lock_guard<std::mutex> lock(mutex);
+    return assigned_;
+}
+
+auto session_pool_t::connected() const -> bool {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    return std::any_of(slots.begin(), slots.end(), [](const std::shared_ptr<slot_t>& slot) {
+        return slot->session->connected();
+    });
+}
+
+void
+session_pool_t::assign(const std::vector<endpoint_type>& endpoints) {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    assigned_ = true;
+
+    if (!options.spread) {
+        for (auto& slot : slots) {
+            slot->endpoints = endpoints;
+        }
+
+        return;
+    }
+
+    std::vector<std::shared_ptr<slot_t>> updated;
+    updated.reserve(endpoints.size() * options.pool);
+
+    for (auto it = endpoints.begin(); it != endpoints.end(); ++it) {
+        const auto& endpoint = *it;
+
+        if (std::find(endpoints.begin(), it, endpoint) != it) {
+            continue;
+        }
+
+        const auto size = updated.size();
+        for (const auto& slot : slots) {
+            if (slot->endpoints.front() == endpoint) {
+                updated.push_back(slot);
+            }
+        }
+
+        if (updated.size() == size) {
+            CF_DBG("adding %llu sessions to %s", CF_US(options.pool), CF_MSG(endpoint).c_str());
+
+            for (std::size_t id = 0; id < options.pool; ++id) {
+                updated.push_back(make_slot(std::vector<endpoint_type>{{ endpoint }}));
+            }
+        }
+    }
+
+    CF_DBG("assigned %llu endpoints, %llu sessions total", CF_US(endpoints.size()), CF_US(updated.size()));
+
+    const bool changed = updated.size() != slots.size() ||
+        !std::equal(updated.begin(), updated.end(), slots.begin());
+
+    slots.swap(updated);
+
+    if (changed) {
+        rebuild();
+    }
+}
+
+auto session_pool_t::select() -> std::shared_ptr<session_t> {
+    std::unique_lock<std::mutex> lock(mutex);
+
+    if (slots.empty()) {
+        return nullptr;
+    }
+
+    const auto now = std::chrono::steady_clock::now();
+    const auto selected = options.spread ? two_choices(now) : least_loaded(now);
+    lock.unlock();
+
+    return lease(selected);
+}
+
+auto session_pool_t::select(const std::string& key) -> std::shared_ptr<session_t> {
+    std::unique_lock<std::mutex> lock(mutex);
+
+    if (slots.empty()) {
+        return nullptr;
+    }
+
+    const auto now = std::chrono::steady_clock::now();
+    const auto selected = options.spread ? consistent(key, now) : least_loaded(now);
+    lock.unlock();
+
+    return lease(selected);
+}
+
+auto session_pool_t::select_other(const session_t* exclude) -> std::shared_ptr<session_t> {
+    std::unique_lock<std::mutex> lock(mutex);
+
+    const auto now = std::chrono::steady_clock::now();
+
+    std::shared_ptr<slot_t> selected;
+    std::uint64_t cost = std::numeric_limits<std::uint64_t>::max();
+
+    for (const auto& slot : slots) {
+        if (slot->session.get() == exclude || !slot->eligible(now) || !slot->session->connected()) {
+            continue;
+        }
+
+        const auto current = slot->cost();
+        if (current < cost) {
+            selected = slot;
+            cost = current;
+        }
+    }
+
+    lock.unlock();
+
+    if (!selected) {
+        return nullptr;
+    }
+
+    return lease(selected);
+}
+
+auto session_pool_t::select_all() -> std::vector<std::pair<endpoint_type, std::shared_ptr<session_t>>> {
+    std::unique_lock<std::mutex> lock(mutex);
+
+    // Without spread mode the whole pool is a single group.
+    const auto group = options.spread ? options.pool : slots.size();
+
+    std::vector<std::pair<endpoint_type, std::shared_ptr<slot_t>>> selected;
+    for (std::size_t begin = 0; begin < slots.size(); begin += group) {
+        std::shared_ptr<slot_t> slot;
+        std::pair<bool, std::size_t> cost(true, std::numeric_limits<std::size_t>::max());
+
+        for (std::size_t id = begin; id < begin + group; ++id) {
+            // Connected sessions go first, since in non-spread mode only their peer is known.
+            const auto current = std::make_pair(!slots[id]->session->connected(), slots[id]->load());
+            if (!slot || current < cost) {
+                slot = slots[id];
+                cost = current;
+            }
+        }
+
+        if (slot->endpoints.empty()) {
+            continue;
+        }
+
+        // In spread mode each session has a single endpoint to connect to. Otherwise a session may
+        // connect to any of the resolved endpoints, so it's labelled with its actual peer, if any.
+        if (options.spread) {
+            selected.push_back(std::make_pair(slot->endpoints.front(), slot));
+        } else if (slot->session->connected()) {
+            if (auto endpoint = slot->session->endpoint()) {
+                selected.push_back(std::make_pair(*endpoint, slot));
+            }
+        }
+    }
+
+    lock.unlock();
+
+    std::vector<std::pair<endpoint_type, std::shared_ptr<session_t>>> result;
+    result.reserve(selected.size());
+
+    for (auto& item : selected) {
+        result.push_back(std::make_pair(item.first, lease(std::move(item.second))));
+    }
+
+    return result;
+}
+
+auto session_pool_t::connect(std::shared_ptr<session_t> session) -> task<void>::future_type {
+    std::unique_lock<std::mutex> lock(mutex);
+
+    auto it = std::find_if(slots.begin(), slots.end(), [&](const std::shared_ptr<slot_t>& slot) {
+        return slot->session.get() == session.get();
+    });
+
+    if (it == slots.end()) {
+        // The session has been dropped from the pool since it was selected.
+        return make_ready_future<void>::error(std::system_error(asio::error::not_found));
+    }
+
+    auto slot = *it;
+    const auto endpoints = slot->endpoints;
+    lock.unlock();
+
+    return slot->session->connect(endpoints)
+        .then(trace::wrap(trace_t::bind(&session_pool_t::on_connect, shared_from_this(), ph::_1, slot)));
+}
+
+auto session_pool_t::quarantined(const session_t* session) const -> std::exception_ptr {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    auto it = std::find_if(slots.begin(), slots.end(), [&](const std::shared_ptr<slot_t>& slot) {
+        return slot->session.get() == session;
+    });
+
+    if (it == slots.end() || (*it)->eligible(std::chrono::steady_clock::now())) {
+        return nullptr;
+    }
+
+    return (*it)->error;
+}
+
+void
+session_pool_t::hard_shutdown(bool policy) {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    hard_shutdown_ = policy;
+    for (const auto& slot : slots) {
+        slot->session->hard_shutdown(policy);
+    }
+}
+
+auto session_pool_t::sessions() const -> std::vector<std::shared_ptr<session_t>> {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    std::vector<std::shared_ptr<session_t>> result;
+    result.reserve(slots.size());
+
+    for (const auto& slot : slots) {
+        result.push_back(slot->session);
+    }
+
+    return result;
+}
+
+auto session_pool_t::inflight() const -> std::vector<std::size_t> {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    std::vector<std::size_t> result;
+    result.reserve(slots.size());
+
+    for (const auto& slot : slots) {
+        result.push_back(slot->load());
+    }
+
+    return result;
+}
+
+auto session_pool_t::lease(std::shared_ptr<slot_t> slot) -> std::shared_ptr<session_t> {
+    auto session = slot->session.get();
+
+    // The aliasing constructor shares the ownership with the lease, while pointing to the session.
+    auto lease = std::make_shared<lease_t<slot_t>>(std::move(slot));
+    return std::shared_ptr<session_t>(std::move(lease), session);
+}
+
+auto session_pool_t::make_slot(std::vector<endpoint_type> endpoints) -> std::shared_ptr<slot_t> {
+    auto slot = std::make_shared<slot_t>(std::move(endpoints), scheduler, options);
+    slot->session->hard_shutdown(hard_shutdown_);
+    return slot;
+}
+
+void
+session_pool_t::on_connect(task<void>::future_move_type future, std::shared_ptr<slot_t> slot) {
+    try {
+        future.get();
+    } catch (const std::exception& err) {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        const auto period = slot->backoff.next(random);
+        CF_DBG("quarantining session for %lld ms: %s", static_cast<long long>(period.count()), err.what());
+
+        slot->quarantine = std::chrono::steady_clock::now() + period;
+        slot->error = std::current_exception();
+        throw;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    slot->backoff.reset();
+    slot->error = nullptr;
+}
+
+auto session_pool_t::least_loaded(std::chrono::steady_clock::time_point now) -> std::shared_ptr<slot_t> {
+    const auto size = slots.size();
+    const auto start = counter++ % size;
+
+    std::shared_ptr<slot_t> selected;
+    std::size_t load = std::numeric_limits<std::size_t>::max();
+
+    // Quarantined slots are considered only if there is nothing else.
+    for (int pass = 0; pass < 2 && !selected; ++pass) {
+        for (std::size_t id = 0; id < size; ++id) {
+            const auto& slot = slots[(start + id) % size];
+
+            if (pass == 0 && !slot->eligible(now)) {
+                continue;
+            }
+
+            const auto current = slot->load();
+            if (current < load) {
+                selected = slot;
+                load = current;
+
+                if (load == 0) {
+                    break;
+                }
+            }
+        }
+    }
+
+    CF_DBG("selected session with %llu outstanding invocations", CF_US(load));
+    return selected;
+}
+
+auto session_pool_t::two_choices(std::chrono::steady_clock::time_point now) -> std::shared_ptr<slot_t> {
+    std::size_t eligible = 0;
+    for (const auto& slot : slots) {
+        if (slot->eligible(now)) {
+            ++eligible;
+        }
+    }
+
+    const bool all = eligible == 0;
+    if (all) {
+        eligible = slots.size();
+    }
+
+    // Returns the n-th slot among eligible ones.
+    const auto nth = [&](std::size_t n) -> const std::shared_ptr<slot_t>& {
+        for (const auto& slot : slots) {
+            if (all || slot->eligible(now)) {
+                if (n-- == 0) {
+                    return slot;
+                }
+            }
+        }
+
+        BOOST_ASSERT(false);
+        return slots.front();
+    };
+
+    if (eligible == 1) {
+        return nth(0);
+    }
+
+    const auto first = random() % eligible;
+    auto second = random() % (eligible - 1);
+    if (second >= first) {
+        ++second;
+    }
+
+    const auto& lhs = nth(first);
+    const auto& rhs = nth(second);
+    return lhs->cost() <= rhs->cost() ? lhs : rhs;
+}
+
+auto session_pool_t::consistent(const std::string& key, std::chrono::steady_clock::time_point now) -> std::shared_ptr<slot_t> {
+    BOOST_ASSERT(!ring.empty());
+
+    const auto size = slots.size() / options.pool;
+
+    std::vector<std::size_t> loads(size);
+    std::vector<bool> eligible(size);
+    std::size_t total = 0;
+
+    for (std::size_t id = 0; id < slots.size(); ++id) {
+        const auto& slot = slots[id];
+        const auto load = slot->load();
+
+        loads[id / options.pool] += load;
+        total += load;
+
+        if (slot->eligible(now)) {
+            eligible[id / options.pool] = true;
+        }
+    }
+
+    // Some endpoint is always below the average, so the bound can't exclude all of them.
+    const auto capacity = static_cast<std::size_t>(std::ceil(options.bound * (total + 1) / size));
+
+    const auto hash = fnv1a(key);
+    const std::size_t start = std::lower_bound(ring.begin(), ring.end(), point_type(hash, 0)) - ring.begin();
+
+    // Quarantined endpoints are considered only if there is nothing else.
+    std::size_t endpoint = ring[start % ring.size()].second;
+    for (int pass = 0; pass < 2; ++pass) {
+        bool found = false;
+
+        for (std::size_t id = 0; id < ring.size(); ++id) {
+            const auto current = ring[(start + id) % ring.size()].second;
+
+            if ((pass == 0 && !eligible[current]) || loads[current] >= capacity) {
+                continue;
+            }
+
+            endpoint = current;
+            found = true;
+            break;
+        }
+
+        if (found) {
+            break;
+        }
+    }
+
+    std::shared_ptr<slot_t> selected;
+    std::size_t load = std::numeric_limits<std::size_t>::max();
+
+    for (std::size_t id = endpoint * options.pool; id < (endpoint + 1) * options.pool; ++id) {
+        const auto current = slots[id]->load();
+        if (current < load) {
+            selected = slots[id];
+            load = current;
+        }
+    }
+
+    CF_DBG("routed key to endpoint %llu of %llu with %llu outstanding invocations",
+           CF_US(endpoint), CF_US(size), CF_US(loads[endpoint]));
+    return selected;
+}
+
+void
+session_pool_t::rebuild() {
+    ring.clear();
+
+    if (!options.spread) {
+        return;
+    }
+
+    ring.reserve(slots.size() / options.pool * RING_POINTS);
+
+    for (std::size_t id = 0; id < slots.size(); id += options.pool) {
+        const auto& endpoint = slots[id]->endpoints.front();
+        const auto base = endpoint.address().to_string() + ":" + std::to_string(endpoint.port()) + "-";
+
+        for (std::size_t point = 0; point < RING_POINTS; ++point) {
+            ring.push_back(point_type(fnv1a(base + std::to_string(point)), id / options.pool));
+        }
+    }
+
+    std::sort(ring.begin(), ring.end());
+    CF_DBG("rebuilt hash ring with %llu points", CF_US(ring.size()));
+}
@@ -16,6 +16,8 @@
 
 #include "cocaine/framework/receiver.hpp"
 
+#include <system_error>
+
 #include "cocaine/framework/detail/shared_state.hpp"
 #include "cocaine/framework/detail/log.hpp"
 
@@ -34,6 +36,15 @@ basic_receiver_t<Session>::~basic_receiver_t() {
     session->revoke(id);
 }
 
+template<class Session>
+void
+basic_receiver_t<Session>::revoke() {
+    session->revoke(id);
+
+    // Pending receive operations hold this receiver, fail them to break the ownership cycle.
+    state->put(std::make_error_code(std::errc::operation_canceled));
+}
+
 template<class Session>
 task<decoded_message>::future_type
 basic_receiver_t<Session>::recv() {
@@ -0,0 +1,124 @@
+/*
+    Copyright (c) 2015 Evgeny Safronov <division494@gmail.com>
+    Copyright (c) 2011-2015 Other contributors as noted in the AUTHORS file.
+    This file is part of Cocaine.
+    Cocaine is free software; you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+    Cocaine is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Lesser General Public License for more details.
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "cocaine/framework/detail/recycle.hpp"
+
+#include <mutex>
+
+using namespace cocaine::framework::detail;
+
+namespace {
+
+/// The smallest size class, each next one is twice as large.
+const std::size_t MIN_BLOCK_SIZE = 64;
+const std::size_t SIZE_CLASSES = 8;
+
+/// Maximum number of blocks of each size class kept in the cache.
+const std::size_t MAX_CACHED = 256;
+
+struct node_t {
+    node_t* next;
+};
+
+/// Free lists of cached blocks, one per size class, each guarded by its own mutex.
+class cache_t {
+    struct list_t {
+        std::mutex mutex;
+        node_t* head;
+        std::size_t size;
+    };
+
+    list_t lists[SIZE_CLASSES];
+
+public:
+    cache_t() noexcept {
+        for (auto& list : lists) {
+            list.head = nullptr;
+            list.size = 0;
+        }
+    }
+
+    auto pop(std::size_t id) noexcept -> void* {
+        auto& list = lists[id];
+
+        std::lock_guard<std::mutex> lock(list.mutex);
+        auto node = list.head;
+        if (node) {
+            list.head = node->next;
+            --list.size;
+        }
+
+        return node;
+    }
+
+    auto push(std::size_t id, void* block) noexcept -> bool {
+        auto& list = lists[id];
+
+        std::lock_guard<std::mutex> lock(list.mutex);
+        if (list.size == MAX_CACHED) {
+            return false;
+        }
+
+        auto node = static_cast<node_t*>(block);
+        node->next = list.head;
+        list.head = node;
+        ++list.size;
+        return true;
+    }
+};
+
+/// Returns the process-wide cache.
+///
+/// The cache is intentionally never destroyed, so blocks may be released at any point of static
+/// or thread-local objects destruction. Cached blocks are reclaimed by the process exit.
+auto cache() -> cache_t& {
+    static cache_t* cache = new cache_t;
+    return *cache;
+}
+
+/// Returns the size class of the given size, or SIZE_CLASSES if the size is too large.
+auto classify(std::size_t size) noexcept -> std::size_t {
+    std::size_t id = 0;
+    for (std::size_t block = MIN_BLOCK_SIZE; block < size && id < SIZE_CLASSES; block *= 2) {
+        ++id;
+    }
+
+    return id;
+}
+
+} // namespace
+
+auto block_cache_t::allocate(std::size_t size) -> void* {
+    const auto id = classify(size);
+    if (id == SIZE_CLASSES) {
+        return ::operator new(size);
+    }
+
+    if (auto block = cache().pop(id)) {
+        return block;
+    }
+
+    // Allocate the whole size class block to be able to reuse it for any size of the class.
+    return ::operator new(MIN_BLOCK_SIZE << id);
+}
+
+void
+block_cache_t::deallocate(void* block, std::size_t size) noexcept {
+    const auto id = classify(size);
+    if (id == SIZE_CLASSES || !cache().push(id, block)) {
+        ::operator delete(block);
+    }
+}
@@ -16,6 +16,18 @@
 
 #include "cocaine/framework/detail/resolver.hpp"
 
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <mutex>
+
+#include <boost/uuid/uuid.hpp>
+#include <boost/uuid/uuid_generators.hpp>
+#include <boost/uuid/uuid_io.hpp>
+
+#include <asio/deadline_timer.hpp>
+#include <asio/error.hpp>
+
 #include <cocaine/idl/locator.hpp>
 #include <cocaine/traits/endpoint.hpp>
 #include <cocaine/traits/error_code.hpp>
@@ -29,7 +41,9 @@
 
 #include "cocaine/framework/detail/basic_session.hpp"
 #include "cocaine/framework/detail/log.hpp"
+#include "cocaine/framework/detail/loop.hpp"
 #include "cocaine/framework/detail/net.hpp"
+#include "cocaine/framework/detail/snapshot.hpp"
 
 namespace ph = std::placeholders;
 
@@ -37,10 +51,195 @@ using namespace cocaine;
 using namespace cocaine::framework;
 using namespace cocaine::framework::detail;
 
+/// How long a failed Locator is ranked below the others.
+static const std::chrono::seconds LOCATOR_FAILURE_PERIOD(30);
+
+class resolver_t::locators_t {
+    struct stats_t {
+        endpoint_type endpoint;
+
+        /// Smoothed resolve latency, zero if there were no observations yet.
+        std::chrono::microseconds latency;
+
+        /// Number of consecutive failures and the time of the last one.
+        std::size_t failures;
+        std::chrono::steady_clock::time_point failed;
+    };
+
+    scheduler_t& scheduler;
+    std::shared_ptr<session_t> current;
+    std::vector<stats_t> stats;
+    mutable std::mutex mutex;
+
+public:
+    explicit locators_t(scheduler_t& scheduler) :
+        scheduler(scheduler),
+        current(std::make_shared<session_t>(scheduler))
+    {}
+
+    ~locators_t() {
+        // The subscription channel would otherwise keep the connection open forever.
+        current->hard_shutdown(true);
+    }
+
+    auto session() const -> std::shared_ptr<session_t> {
+        std::lock_guard<std::mutex> lock(mutex);
+        return current;
+    }
+
+    /// Orders the given endpoints from the best to the worst.
+    ///
+    /// Recently failed Locators go last, others are ordered by their latency. Locators without
+    /// observations are considered the fastest ones to let them warm up.
+    auto rank(std::vector<endpoint_type> endpoints) const -> std::vector<endpoint_type> {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        const auto now = std::chrono::steady_clock::now();
+        std::stable_sort(endpoints.begin(), endpoints.end(), [&](const endpoint_type& lhs, const endpoint_type& rhs) {
+            return cost(lhs, now) < cost(rhs, now);
+        });
+
+        return endpoints;
+    }
+
+    void
+    success(const std::shared_ptr<session_t>& session, std::chrono::microseconds latency) {
+        const auto endpoint = session->endpoint();
+        if (!endpoint) {
+            return;
+        }
+
+        std::lock_guard<std::mutex> lock(mutex);
+
+        auto& entry = find(*endpoint);
+        entry.failures = 0;
+        entry.latency = entry.latency.count() == 0 ? latency : (entry.latency * 7 + latency) / 8;
+    }
+
+    /// Records the transport failure of the given session, abandoning it if it's still the current
+    /// one.
+    void
+    failure(const std::shared_ptr<session_t>& session) {
+        const auto endpoint = session->endpoint();
+
+        std::lock_guard<std::mutex> lock(mutex);
+
+        if (endpoint) {
+            penalize(*endpoint);
+        }
+
+        if (current == session) {
+            CF_DBG("abandoning the locator session");
+            current->hard_shutdown(true);
+            current = std::make_shared<session_t>(scheduler);
+        }
+    }
+
+    /// Records the timed out resolve over the given session.
+    ///
+    /// Unlike failures the session is kept, since other resolves multiplexed over it and the
+    /// announcement subscription are still fine. The Locator is only ranked down on reconnect.
+    void
+    timeout(const std::shared_ptr<session_t>& session) {
+        const auto endpoint = session->endpoint();
+        if (!endpoint) {
+            return;
+        }
+
+        std::lock_guard<std::mutex> lock(mutex);
+        penalize(*endpoint);
+    }
+
+private:
+    /// \pre mutex is locked.
+    void
+    penalize(const endpoint_type& endpoint) {
+        auto& entry = find(endpoint);
+        ++entry.failures;
+        entry.failed = std::chrono::steady_clock::now();
+    }
+
+    auto cost(const endpoint_type& endpoint, std::chrono::steady_clock::time_point now) const ->
+        std::pair<std::size_t, std::chrono::microseconds::rep>
+    {
+        for (const auto& entry : stats) {
+            if (entry.endpoint == endpoint) {
+                const bool recent = now - entry.failed < LOCATOR_FAILURE_PERIOD;
+                return std::make_pair(recent ? entry.failures : 0, entry.latency.count());
+            }
+        }
+
+        return std::make_pair(0, 0);
+    }
+
+    auto find(const endpoint_type& endpoint) -> stats_t& {
+        for (auto& entry : stats) {
+            if (entry.endpoint == endpoint) {
+                return entry;
+            }
+        }
+
+        stats.push_back(stats_t{ endpoint, std::chrono::microseconds(0), 0, std::chrono::steady_clock::time_point() });
+        return stats.back();
+    }
+};
+
 namespace {
 
 typedef std::tuple<std::vector<asio::ip::tcp::endpoint>, uint, io::graph_root_t> resolve_result;
 
+/// A single resolve racing with its timeout.
+struct attempt_t {
+    std::shared_ptr<resolver_t::locators_t> locators;
+    std::shared_ptr<session_t> session;
+    std::chrono::steady_clock::time_point birth;
+    std::atomic<bool> completed;
+    task<resolver_t::result_t>::promise_type promise;
+
+    /// Revokes the channel of the resolve once it's invoked.
+    std::function<void()> revoker;
+    std::mutex mutex;
+
+    attempt_t(std::shared_ptr<resolver_t::locators_t> locators, std::shared_ptr<session_t> session) :
+        locators(std::move(locators)),
+        session(std::move(session)),
+        birth(std::chrono::steady_clock::now()),
+        completed(false)
+    {}
+
+    /// Registers the revoker of the resolve channel, calling it at once if already timed out.
+    void
+    track(std::function<void()> revoker) {
+        std::unique_lock<std::mutex> lock(mutex);
+
+        if (!completed) {
+            this->revoker = std::move(revoker);
+            return;
+        }
+
+        lock.unlock();
+        revoker();
+    }
+
+    /// Revokes the resolve channel, if any, after the timeout.
+    void
+    revoke() {
+        std::unique_lock<std::mutex> lock(mutex);
+        auto revoker = std::move(this->revoker);
+        lock.unlock();
+
+        if (revoker) {
+            revoker();
+        }
+    }
+};
+
+typedef channel<io::locator::connect>::receiver_type announce_receiver;
+typedef std::decay<decltype(std::declval<announce_receiver&>().recv().get())>::type announce_result;
+
+/// Delay before resubscribing to the Locator announcements after the subscription breaks.
+const std::chrono::milliseconds RESUBSCRIBE_DELAY(1000);
+
 resolver_t::result_t
 on_resolve(task<resolve_result>::future_move_type future,
            std::shared_ptr<session_t>,
@@ -69,9 +268,10 @@ on_resolve(task<resolve_result>::future_move_type future,
 }
 
 task<resolve_result>::future_type
-on_invoke(task<channel<io::locator::resolve>>::future_move_type future, std::shared_ptr<session_t>) {
+on_invoke(task<channel<io::locator::resolve>>::future_move_type future, std::shared_ptr<attempt_t> attempt) {
     try {
         auto channel = future.get();
+        attempt->track(channel.rx.revoker());
         return channel.rx.recv();
     } catch (const std::exception& err) {
         CF_DBG("<< resolving - invocation error: %s", err.what());
@@ -80,30 +280,209 @@ on_invoke(task<channel<io::locator::resolve>>::future_move_type future, std::sha
 }
 
 task<channel<io::locator::resolve>>::future_type
-on_connect(task<void>::future_move_type future, std::shared_ptr<session_t> locator, std::string name) {
+on_connect(task<void>::future_move_type future,
+           std::shared_ptr<session_t> locator,
+           std::shared_ptr<const prepared<io::locator::resolve>> request)
+{
     try {
         future.get();
 
         CF_DBG("<< connect to the locator: ok");
         CF_DBG(">> resolving ...");
-        return locator->invoke<io::locator::resolve>(name);
+        return locator->invoke<io::locator::resolve>(*request);
     } catch (const std::system_error& err) {
         CF_DBG("<< connecting - error: %s", err.what());
         throw;
     }
 }
 
+void
+on_attempt(task<resolver_t::result_t>::future_move_type future, std::shared_ptr<attempt_t> attempt) {
+    if (attempt->completed.exchange(true)) {
+        // Already timed out, the Locator has been penalized for that.
+        return;
+    }
+
+    const auto latency = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - attempt->birth
+    );
+
+    try {
+        auto result = future.get();
+        attempt->locators->success(attempt->session, latency);
+        attempt->promise.set_value(std::move(result));
+    } catch (const cocaine::framework::error_t&) {
+        // The Locator has responded, so it's healthy.
+        attempt->locators->success(attempt->session, latency);
+        attempt->promise.set_exception(std::current_exception());
+    } catch (const std::exception&) {
+        attempt->locators->failure(attempt->session);
+        attempt->promise.set_exception(std::current_exception());
+    }
+}
+
+void
+on_timeout(const std::error_code& ec,
+           std::shared_ptr<asio::deadline_timer> /* timer */,
+           std::shared_ptr<attempt_t> attempt)
+{
+    if (ec || attempt->completed.exchange(true)) {
+        return;
+    }
+
+    CF_DBG("<< resolving - timed out");
+    // The Locator session is shared, so only this resolve is given up on.
+    attempt->locators->timeout(attempt->session);
+    attempt->revoke();
+    attempt->promise.set_exception(std::system_error(asio::error::timed_out));
+}
+
+task<void>::future_type
+on_hosts(task<std::vector<resolver_t::endpoint_type>>::future_move_type future,
+         std::shared_ptr<session_t> locator,
+         std::shared_ptr<resolver_t::locators_t> locators)
+{
+    return locator->connect(locators->rank(future.get()));
+}
+
+task<channel<io::locator::connect>>::future_type
+on_connect_subscribe(task<void>::future_move_type future,
+                     std::shared_ptr<session_t> locator,
+                     std::string uuid)
+{
+    future.get();
+
+    CF_DBG(">> subscribing ...");
+    return locator->invoke<io::locator::connect>(std::move(uuid));
+}
+
+void
+on_announce(task<announce_result>::future_move_type future,
+            std::weak_ptr<serialized_resolver_t> weak,
+            announce_receiver rx)
+{
+    boost::optional<announce_result::value_type> announce;
+    std::string error = "closed by the locator";
+
+    try {
+        announce = future.get();
+    } catch (const std::exception& err) {
+        error = err.what();
+    }
+
+    auto resolver = weak.lock();
+    if (!resolver) {
+        return;
+    }
+
+    if (!announce) {
+        CF_DBG("<< subscription broken: %s", error.c_str());
+        resolver->watch(RESUBSCRIBE_DELAY);
+        return;
+    }
+
+    for (const auto& service : std::get<1>(*announce)) {
+        resolver_t::result_t result = {
+            endpoints_cast<boost::asio::ip::tcp::endpoint>(std::get<0>(service.second)),
+            std::get<1>(service.second)
+        };
+
+        resolver->announce(service.first, std::move(result));
+    }
+
+    rx.recv()
+        .then(trace::wrap(trace_t::bind(&on_announce, ph::_1, std::move(weak), rx)));
+}
+
+void
+on_subscribe(task<channel<io::locator::connect>>::future_move_type future,
+             std::weak_ptr<serialized_resolver_t> weak)
+{
+    try {
+        auto rx = future.get().rx;
+        CF_DBG("<< subscribed");
+
+        rx.recv()
+            .then(trace::wrap(trace_t::bind(&on_announce, ph::_1, std::move(weak), rx)));
+    } catch (const std::exception& err) {
+        CF_DBG("<< subscribing - error: %s", err.what());
+
+        if (auto resolver = weak.lock()) {
+            resolver->watch(RESUBSCRIBE_DELAY);
+        }
+    }
+}
+
+void
+on_resubscribe(const std::error_code& ec,
+               std::shared_ptr<asio::deadline_timer> /* timer */,
+               std::weak_ptr<serialized_resolver_t> weak)
+{
+    if (ec) {
+        return;
+    }
+
+    if (auto resolver = weak.lock()) {
+        resolver->watch(std::chrono::milliseconds(0));
+    }
+}
+
+auto equal(const resolver_t::result_t& lhs, const resolver_t::result_t& rhs) -> bool {
+    return lhs.endpoints == rhs.endpoints && lhs.version == rhs.version;
+}
+
+void
+on_prefetch(task<serialized_resolver_t::result_type>::future_move_type future,
+            std::shared_ptr<serialized_resolver_t> resolver,
+            std::string name)
+{
+    resolver->preload(name, future.get());
+}
+
+void
+on_prefetch_all(task<std::vector<task<void>::future_type>>::future_move_type future) {
+    auto futures = future.get();
+
+    std::exception_ptr error;
+    for (auto& future : futures) {
+        try {
+            future.get();
+        } catch (...) {
+            if (!error) {
+                error = std::current_exception();
+            }
+        }
+    }
+
+    if (error) {
+        CF_DBG("<< prefetching - failed");
+        std::rethrow_exception(error);
+    }
+
+    CF_DBG("<< prefetching - done");
+}
+
 } // namespace
 
-resolver_t::resolver_t(scheduler_t& scheduler) :
-    scheduler(scheduler)
+resolver_t::resolver_t(scheduler_t& scheduler,
+                       std::chrono::milliseconds timeout,
+                       std::shared_ptr<locators_t> locators) :
+    scheduler(scheduler),
+    timeout(timeout),
+    locators(locators ? std::move(locators) : std::make_shared<locators_t>(scheduler))
 {
     endpoints_.emplace_back(boost::asio::ip::tcp::v6(), 10053);
 }
 
-resolver_t::~resolver_t() {}
+auto resolver_t::shared() const -> std::shared_ptr<locators_t> {
+    return locators;
+}
 
 std::vector<resolver_t::endpoint_type> resolver_t::endpoints() const {
+    if (hosts) {
+        return hosts->current();
+    }
+
     return endpoints_;
 }
 
@@ -111,35 +490,167 @@ void resolver_t::endpoints(std::vector<resolver_t::endpoint_type> endpoints) {
     endpoints_ = std::move(endpoints);
 }
 
+void resolver_t::endpoints(std::shared_ptr<dns_resolver_t> hosts) {
+    this->hosts = std::move(hosts);
+}
+
+auto resolver_t::connect(std::shared_ptr<session_t> locator) -> task<void>::future_type {
+    CF_DBG(">> connecting to the locator ...");
+
+    if (!hosts) {
+        return locator->connect(locators->rank(endpoints()));
+    }
+
+    return hosts->endpoints()
+        .then(scheduler, trace::wrap(trace_t::bind(&on_hosts, ph::_1, locator, locators)));
+}
+
 auto resolver_t::resolve(std::string name) -> task<resolver_t::result_t>::future_type {
+    auto request = std::make_shared<const prepared<io::locator::resolve>>(name);
+    return resolve(std::move(name), std::move(request));
+}
+
+auto resolver_t::resolve(std::string name, std::shared_ptr<const prepared<io::locator::resolve>> request) ->
+    task<resolver_t::result_t>::future_type
+{
     CF_CTX("R");
 
-    auto locator = std::make_shared<session_t>(scheduler);
+    auto locator = locators->session();
+    auto attempt = std::make_shared<attempt_t>(locators, locator);
+    auto result = attempt->promise.get_future();
 
-    CF_DBG(">> connecting to the locator ...");
-    return locator->connect(endpoints())
-        .then(scheduler, trace::wrap(trace_t::bind(&on_connect, ph::_1, locator, name)))
-        .then(scheduler, trace::wrap(trace_t::bind(&on_invoke, ph::_1, locator)))
-        .then(scheduler, trace::wrap(trace_t::bind(&on_resolve, ph::_1, locator, name)));
+    task<channel<io::locator::resolve>>::future_type future;
+
+    // All resolves are multiplexed over the single locator session, which reconnects lazily after
+    // the connection is lost.
+    if (locator->connected()) {
+        CF_DBG(">> resolving ...");
+        future = locator->invoke<io::locator::resolve>(*request);
+    } else {
+        future = connect(locator)
+            .then(scheduler, trace::wrap(trace_t::bind(&on_connect, ph::_1, locator, std::move(request))));
+    }
+
+    future
+        .then(scheduler, trace::wrap(trace_t::bind(&on_invoke, ph::_1, attempt)))
+        .then(scheduler, trace::wrap(trace_t::bind(&on_resolve, ph::_1, locator, name)))
+        .then(scheduler, trace::wrap(trace_t::bind(&on_attempt, ph::_1, attempt)));
+
+    if (timeout.count() > 0) {
+        auto timer = std::make_shared<asio::deadline_timer>(scheduler.loop().loop);
+        timer->expires_from_now(boost::posix_time::milliseconds(timeout.count()));
+        timer->async_wait(std::bind(&on_timeout, ph::_1, timer, std::move(attempt)));
+    }
+
+    return result;
 }
 
-serialized_resolver_t::serialized_resolver_t(std::vector<endpoint_type> endpoints, scheduler_t& scheduler) :
-    resolver(scheduler),
-    scheduler(scheduler)
+auto resolver_t::subscribe(std::string uuid) -> task<channel<io::locator::connect>>::future_type {
+    CF_CTX("R");
+
+    auto locator = locators->session();
+    if (locator->connected()) {
+        CF_DBG(">> subscribing ...");
+        return locator->invoke<io::locator::connect>(std::move(uuid));
+    }
+
+    return connect(locator)
+        .then(scheduler, trace::wrap(trace_t::bind(&on_connect_subscribe, ph::_1, locator, std::move(uuid))));
+}
+
+serialized_resolver_t::serialized_resolver_t(std::vector<endpoint_type> endpoints,
+                                             scheduler_t& scheduler,
+                                             resolve_options_t options,
+                                             std::shared_ptr<resolver_t::locators_t> locators) :
+    resolver(scheduler, options.timeout, std::move(locators)),
+    scheduler(scheduler),
+    options(std::move(options)),
+    random(std::random_device()()),
+    subscribers(0),
+    watching(false)
 {
     resolver.endpoints(std::move(endpoints));
 }
 
+serialized_resolver_t::serialized_resolver_t(std::shared_ptr<dns_resolver_t> hosts,
+                                             scheduler_t& scheduler,
+                                             resolve_options_t options,
+                                             std::shared_ptr<resolver_t::locators_t> locators) :
+    resolver(scheduler, options.timeout, std::move(locators)),
+    scheduler(scheduler),
+    options(std::move(options)),
+    random(std::random_device()()),
+    subscribers(0),
+    watching(false)
+{
+    resolver.endpoints(std::move(hosts));
+}
+
+auto serialized_resolver_t::shared() const -> std::shared_ptr<resolver_t::locators_t> {
+    return resolver.shared();
+}
+
 auto serialized_resolver_t::resolve(std::string name) -> task<result_type>::future_type {
     std::unique_lock<std::mutex> lock(mutex);
 
+    auto prefetch = prefetched.find(name);
+    if (prefetch != prefetched.end()) {
+        CF_DBG("<< resolving - prefetched");
+        auto result = std::move(prefetch->second);
+        prefetched.erase(prefetch);
+        return make_ready_future<result_type>::value(std::move(result));
+    }
+
+    auto loaded = provisional.find(name);
+    if (loaded != provisional.end()) {
+        CF_DBG("<< resolving - loaded from the snapshot");
+        auto result = std::move(loaded->second);
+        provisional.erase(loaded);
+
+        // The snapshot may be outdated, subscribers are notified if the Locator disagrees.
+        if (inprogress.find(name) == inprogress.end()) {
+            CF_DBG(">> revalidating ...");
+            start(name);
+        }
+
+        return make_ready_future<result_type>::value(std::move(result));
+    }
+
+    auto miss = missing.find(name);
+    if (miss != missing.end() && std::chrono::steady_clock::now() < miss->second.until) {
+        CF_DBG("<< resolving - not found recently");
+        ++miss->second.suppressed;
+        return make_ready_future<result_type>::error(service_not_found(name));
+    }
+
+    if (options.ttl.count() > 0) {
+        auto cached = cache.find(name);
+        if (cached != cache.end()) {
+            const auto age = std::chrono::steady_clock::now() - cached->second.birth;
+
+            if (age < options.ttl) {
+                CF_DBG("<< resolving - cached");
+                return make_ready_future<result_type>::value(cached->second.result);
+            }
+
+            if (age < options.ttl + options.stale) {
+                if (inprogress.find(name) == inprogress.end()) {
+                    CF_DBG(">> refreshing stale resolve result ...");
+                    start(name);
+                }
+
+                return make_ready_future<result_type>::value(cached->second.result);
+            }
+
+            cache.erase(cached);
+        }
+    }
+
     auto it = inprogress.find(name);
     if (it == inprogress.end()) {
-        std::deque<task<result_type>::promise_type> queue;
-        inprogress.insert(it, std::make_pair(name, queue));
+        auto future = start(name);
         lock.unlock();
-        return resolver.resolve(name)
-            .then(scheduler, trace::wrap(trace_t::bind(&serialized_resolver_t::notify_all, shared_from_this(), ph::_1, name)));
+        return future;
     } else {
         task<result_type>::promise_type promise;
         auto future = promise.get_future();
@@ -148,13 +659,188 @@ auto serialized_resolver_t::resolve(std::string name) -> task<result_type>::futu
     }
 }
 
-serialized_resolver_t::result_type
-serialized_resolver_t::notify_all(task<result_type>::future_move_type future, std::string name) {
+void
+serialized_resolver_t::invalidate(const std::string& name) {
+    std::lock_guard<std::mutex> lock(mutex);
+    cache.erase(name);
+}
+
+auto serialized_resolver_t::prefetch(const std::vector<std::string>& names) -> task<void>::future_type {
+    CF_DBG(">> prefetching %llu services ...", CF_US(names.size()));
+
+    std::vector<task<void>::future_type> futures;
+    futures.reserve(names.size());
+
+    for (const auto& name : names) {
+        futures.push_back(
+            resolve(name)
+                .then(trace::wrap(trace_t::bind(&on_prefetch, ph::_1, shared_from_this(), name)))
+        );
+    }
+
+    return when_all(futures)
+        .then(trace::wrap(trace_t::bind(&on_prefetch_all, ph::_1)));
+}
+
+auto serialized_resolver_t::suppressed(const std::string& name) const -> std::uint64_t {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    auto it = missing.find(name);
+    if (it == missing.end()) {
+        return 0;
+    }
+
+    return it->second.suppressed;
+}
+
+void
+serialized_resolver_t::preload(const std::string& name, result_type result) {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    latest[name] = result;
+    prefetched[name] = std::move(result);
+}
+
+auto serialized_resolver_t::subscribe(const std::string& name, update_handler_t handler) -> std::uint64_t {
+    std::unique_lock<std::mutex> lock(mutex);
+
+    const auto id = subscribers++;
+    handlers.insert(std::make_pair(name, subscriber_t{ id, std::move(handler) }));
+
+    if (!options.watch || watching) {
+        return id;
+    }
+
+    watching = true;
+    lock.unlock();
+
+    watch(std::chrono::milliseconds(0));
+    return id;
+}
+
+void
+serialized_resolver_t::unsubscribe(const std::string& name, std::uint64_t id) {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    const auto range = handlers.equal_range(name);
+    for (auto it = range.first; it != range.second; ++it) {
+        if (it->second.id == id) {
+            handlers.erase(it);
+            return;
+        }
+    }
+}
+
+void
+serialized_resolver_t::watch(std::chrono::milliseconds delay) {
+    std::weak_ptr<serialized_resolver_t> weak = shared_from_this();
+
+    if (delay.count() > 0) {
+        auto timer = std::make_shared<asio::deadline_timer>(scheduler.loop().loop);
+        timer->expires_from_now(boost::posix_time::milliseconds(delay.count()));
+        timer->async_wait(std::bind(&on_resubscribe, ph::_1, timer, std::move(weak)));
+        return;
+    }
+
+    // Each subscription is registered by the Locator as a separate remote, so it needs a unique id.
+    const auto uuid = boost::uuids::to_string(boost::uuids::random_generator()());
+
+    resolver.subscribe(uuid)
+        .then(scheduler, trace::wrap(trace_t::bind(&on_subscribe, ph::_1, std::move(weak))));
+}
+
+void
+serialized_resolver_t::announce(const std::string& name, result_type result) {
+    std::unique_lock<std::mutex> lock(mutex);
+
+    // The service has appeared, so there is no reason to fail its resolves anymore.
+    missing.erase(name);
+
+    auto it = latest.find(name);
+    if (it == latest.end()) {
+        return;
+    }
+
+    if (equal(it->second, result)) {
+        return;
+    }
+
+    CF_DBG("<< service '%s' has moved to %llu endpoints", name.c_str(), CF_US(result.endpoints.size()));
+    it->second = result;
+
+    if (options.ttl.count() > 0) {
+        cache[name] = cached_t{ result, std::chrono::steady_clock::now() };
+    }
+
+    notify(name, result);
+    save();
+}
+
+void
+serialized_resolver_t::persist(std::string path) {
+    snapshot_t loaded;
+
+    try {
+        loaded = read_snapshot(path);
+        CF_DBG("<< loaded %llu services from the snapshot", CF_US(loaded.size()));
+    } catch (const std::exception& err) {
+        CF_DBG("<< failed to load the snapshot: %s", err.what());
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+
+    writer = std::make_shared<snapshot_writer_t>(std::move(path));
+    for (auto& service : loaded) {
+        latest.insert(service);
+        provisional.insert(std::move(service));
+    }
+}
+
+void
+serialized_resolver_t::notify(const std::string& name, const result_type& result) {
+    const auto range = handlers.equal_range(name);
+    for (auto handler = range.first; handler != range.second; ++handler) {
+        scheduler(std::bind(handler->second.handler, name, result));
+    }
+}
+
+void
+serialized_resolver_t::save() {
+    if (!writer) {
+        return;
+    }
+
+    // The whole snapshot is small, so it's rewritten from scratch, but changes made while the
+    // previous one is being written are coalesced.
+    writer->write(latest);
+}
+
+auto serialized_resolver_t::start(const std::string& name) -> task<result_type>::future_type {
+    inprogress.insert(std::make_pair(name, std::deque<task<result_type>::promise_type>()));
+
+    auto& request = requests[name];
+    if (!request) {
+        request = std::make_shared<const prepared<io::locator::resolve>>(name);
+    }
+
+    // Each other Locator is tried once if the preferred one fails or times out.
+    const auto locators = resolver.endpoints().size();
+    return attempt(name, locators > 1 ? locators - 1 : 0);
+}
+
+auto serialized_resolver_t::attempt(const std::string& name, std::size_t retries) -> task<result_type>::future_type {
+    return resolver.resolve(name, requests[name])
+        .then(scheduler, trace::wrap(trace_t::bind(&serialized_resolver_t::notify_all, shared_from_this(), ph::_1, name, retries)));
+}
+
+auto serialized_resolver_t::notify_all(task<result_type>::future_move_type future, std::string name, std::size_t retries) ->
+    task<result_type>::future_type
+{
     std::lock_guard<std::mutex> lock(mutex);
 
     auto it = inprogress.find(name);
     if (it == inprogress.end()) {
-        return future.get();
+        return make_ready_future<result_type>::value(future.get());
     }
 
     try {
@@ -163,8 +849,47 @@ serialized_resolver_t::notify_all(task<result_type>::future_move_type future, st
             promise.set_value(result);
         }
         inprogress.erase(it);
-        return result;
+        missing.erase(name);
+
+        auto previous = latest.find(name);
+        if (previous == latest.end()) {
+            latest.insert(std::make_pair(name, result));
+            save();
+        } else if (!equal(previous->second, result)) {
+            previous->second = result;
+            notify(name, result);
+            save();
+        }
+
+        if (options.ttl.count() > 0) {
+            cache[name] = cached_t{ result, std::chrono::steady_clock::now() };
+        }
+
+        return make_ready_future<result_type>::value(std::move(result));
     } catch (const std::system_error& err) {
+        // Errors reported by the Locator itself won't change when asking another one, while timed
+        // out resolves would be retried over the same Locator session.
+        const bool retriable = dynamic_cast<const cocaine::framework::error_t*>(&err) == nullptr &&
+            err.code() != std::error_code(asio::error::timed_out);
+
+        if (retries > 0 && retriable) {
+            CF_DBG("<< resolving - failed: %s, trying another locator ...", err.what());
+            return attempt(name, retries - 1);
+        }
+
+        if (options.negative.count() > 0 && dynamic_cast<const service_not_found*>(&err)) {
+            auto miss = missing.find(name);
+            if (miss == missing.end()) {
+                miss = missing.insert(std::make_pair(name, missing_t{
+                    backoff_t(options.negative, options.negative_cap), std::chrono::steady_clock::time_point(), 0
+                })).first;
+            }
+
+            const auto period = miss->second.backoff.next(random);
+            CF_DBG("<< service not found, failing its resolves for %lld ms", static_cast<long long>(period.count()));
+            miss->second.until = std::chrono::steady_clock::now() + period;
+        }
+
         for (auto& promise : it->second) {
             promise.set_exception(err);
         }
@@ -14,6 +14,8 @@
     along with this program. If not, see <http://www.gnu.org/licenses/>.
 */
 
+#include <stdexcept>
+
 #include <cocaine/common.hpp>
 
 #include "cocaine/framework/sender.hpp"
@@ -29,8 +31,152 @@ basic_sender_t<Session>::basic_sender_t(std::uint64_t id, std::shared_ptr<sessio
     session(std::move(session))
 {}
 
+template<class Session>
+void
+basic_sender_t<Session>::compress(compression_t compression) {
+    this->compression = std::move(compression);
+}
+
 template<class Session>
 task<void>::future_type
 basic_sender_t<Session>::send(io::encoder_t::message_type&& message) {
-    return session->push(std::move(message));
+    return session->push(id, std::move(message));
+}
+
+template<class Session>
+basic_pipeline_t<Session>::basic_pipeline_t(std::shared_ptr<basic_sender_t<session_type>> sender, window_t window) :
+    sender(std::move(sender)),
+    window(window),
+    chunks(0),
+    bytes(0)
+{
+    if (window.chunks == 0) {
+        throw std::invalid_argument("pipeline window must allow at least one message");
+    }
+
+    if (window.bytes == 0) {
+        throw std::invalid_argument("pipeline window size must be a positive number");
+    }
+}
+
+template<class Session>
+task<void>::future_type
+basic_pipeline_t<Session>::push(io::encoder_t::message_type&& message) {
+    std::unique_lock<std::mutex> lock(mutex);
+
+    if (error) {
+        return make_ready_future<void>::error(error);
+    }
+
+    const auto size = message.size();
+
+    if (!queue.empty() || !fits(size)) {
+        queue.push_back(pending_t{ std::move(message), task<void>::promise_type() });
+        return queue.back().promise.get_future();
+    }
+
+    ++chunks;
+    bytes += size;
+
+    // Sending under the lock keeps the order, while the continuation is attached outside, because
+    // it may be invoked immediately.
+    auto future = sender->send(std::move(message));
+    lock.unlock();
+
+    future.then(std::bind(&basic_pipeline_t::on_write, this->shared_from_this(), std::placeholders::_1, size));
+    return make_ready_future<void>::value();
+}
+
+template<class Session>
+task<void>::future_type
+basic_pipeline_t<Session>::flush() {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    if (error) {
+        return make_ready_future<void>::error(error);
+    }
+
+    if (chunks == 0) {
+        return make_ready_future<void>::value();
+    }
+
+    flushes.emplace_back();
+    return flushes.back().get_future();
+}
+
+template<class Session>
+bool
+basic_pipeline_t<Session>::fits(std::size_t size) const {
+    return chunks < window.chunks && (chunks == 0 || bytes + size <= window.bytes);
+}
+
+template<class Session>
+void
+basic_pipeline_t<Session>::on_write(task<void>::future_move_type future, std::size_t size) {
+    std::exception_ptr err;
+    try {
+        future.get();
+    } catch (...) {
+        err = std::current_exception();
+    }
+
+    std::vector<std::pair<task<void>::future_type, std::size_t>> written;
+    std::vector<task<void>::promise_type> accepted;
+    std::vector<task<void>::promise_type> failed;
+    std::vector<task<void>::promise_type> flushed;
+
+    std::unique_lock<std::mutex> lock(mutex);
+
+    --chunks;
+    bytes -= size;
+
+    if (err && !error) {
+        error = err;
+    }
+
+    if (error) {
+        for (auto& pending : queue) {
+            failed.push_back(std::move(pending.promise));
+        }
+        queue.clear();
+    }
+
+    while (!queue.empty() && fits(queue.front().message.size())) {
+        auto pending = std::move(queue.front());
+        queue.pop_front();
+
+        const auto length = pending.message.size();
+        ++chunks;
+        bytes += length;
+
+        written.emplace_back(sender->send(std::move(pending.message)), length);
+        accepted.push_back(std::move(pending.promise));
+    }
+
+    if (chunks == 0 || error) {
+        flushed.swap(flushes);
+    }
+
+    const auto broken = error;
+    lock.unlock();
+
+    for (auto& item : written) {
+        item.first.then(std::bind(&basic_pipeline_t::on_write, this->shared_from_this(), std::placeholders::_1, item.second));
+    }
+
+    for (auto& promise : accepted) {
+        promise.set_value();
+    }
+
+    for (auto& promise : failed) {
+        promise.set_exception(broken);
+    }
+
+    for (auto& promise : flushed) {
+        if (broken) {
+            promise.set_exception(broken);
+        } else {
+            promise.set_value();
+        }
+    }
 }
@@ -16,8 +16,18 @@
 
 #include "cocaine/framework/service.hpp"
 
+#include <algorithm>
+
+#include <asio/deadline_timer.hpp>
+#include <asio/error.hpp>
+
+#include "cocaine/framework/scheduler.hpp"
+
 #include "cocaine/framework/detail/basic_session.hpp"
+#include "cocaine/framework/detail/breaker.hpp"
 #include "cocaine/framework/detail/log.hpp"
+#include "cocaine/framework/detail/loop.hpp"
+#include "cocaine/framework/detail/pool.hpp"
 #include "cocaine/framework/detail/resolver.hpp"
 #include "cocaine/framework/trace.hpp"
 
@@ -28,27 +38,315 @@ using namespace cocaine::framework::detail;
 
 namespace {
 
-task<void>::future_type
-on_resolve(task<resolver_t::result_t>::future_move_type future, uint version, std::shared_ptr<session_t> session) {
+typedef std::shared_ptr<session_t> session_ptr;
+
+session_ptr
+on_acquire(task<void>::future_move_type future, session_ptr session) {
+    try {
+        future.get();
+        CF_DBG("<< connected");
+    } catch (const std::exception& err) {
+        CF_DBG("<< failed to connect: %s", err.what());
+        throw;
+    }
+
+    return session;
+}
+
+task<session_ptr>::future_type
+connect(const std::shared_ptr<session_pool_t>& pool, session_ptr session) {
+    return pool->connect(session)
+        .then(trace::wrap(trace_t::bind(&::on_acquire, ph::_1, session)));
+}
+
+session_ptr
+select(session_pool_t& pool, const boost::optional<std::string>& key) {
+    return key ? pool.select(*key) : pool.select();
+}
+
+task<session_ptr>::future_type
+acquire(std::shared_ptr<session_pool_t> pool, const std::string& name, const boost::optional<std::string>& key) {
+    auto session = ::select(*pool, key);
+    if (!session) {
+        return make_ready_future<session_ptr>::error(service_not_found(name));
+    }
+
+    if (session->connected()) {
+        return make_ready_future<session_ptr>::value(std::move(session));
+    }
+
+    return ::connect(pool, std::move(session));
+}
+
+void
+on_assign(task<resolver_t::result_t>::future_move_type future, uint version, std::shared_ptr<session_pool_t> pool) {
     auto info = future.get();
     if (version != info.version) {
-        return make_ready_future<void>::error(version_mismatch(version, info.version));
+        throw version_mismatch(version, info.version);
     }
 
-    return session->connect(info.endpoints);
+    pool->assign(info.endpoints);
+}
+
+task<session_ptr>::future_type
+on_resolve(task<void>::future_move_type future,
+           std::string name,
+           std::shared_ptr<session_pool_t> pool,
+           boost::optional<std::string> key)
+{
+    future.get();
+    return acquire(std::move(pool), name, key);
+}
+
+task<session_ptr>::future_type
+resolve(std::shared_ptr<serialized_resolver_t> resolver,
+        std::string name,
+        uint version,
+        std::shared_ptr<session_pool_t> pool,
+        boost::optional<std::string> key)
+{
+    CF_DBG(">> resolving ...");
+
+    return resolver->resolve(name)
+        .then(trace::wrap(trace_t::bind(&::on_assign, ph::_1, version, pool)))
+        .then(trace::wrap(trace_t::bind(&::on_resolve, ph::_1, name, pool, std::move(key))));
+}
+
+task<session_ptr>::future_type
+on_reconnect(task<session_ptr>::future_move_type future,
+             std::shared_ptr<serialized_resolver_t> resolver,
+             std::string name,
+             uint version,
+             std::shared_ptr<session_pool_t> pool,
+             boost::optional<std::string> key)
+{
+    try {
+        return make_ready_future<session_ptr>::value(future.get());
+    } catch (const std::exception& err) {
+        // The endpoint may have gone away. Ask the Locator for fresh endpoints and try once more.
+        CF_DBG("<< failed to reconnect: %s", err.what());
+        resolver->invalidate(name);
+        return resolve(std::move(resolver), std::move(name), version, std::move(pool), std::move(key));
+    }
+}
+
+task<session_ptr>::future_type
+reconnect(std::shared_ptr<session_pool_t> pool,
+          session_ptr session,
+          std::shared_ptr<serialized_resolver_t> resolver,
+          std::string name,
+          uint version,
+          boost::optional<std::string> key)
+{
+    // Reconnect to already known endpoints first, falling back to resolving on failure.
+    CF_DBG(">> reconnecting ...");
+    return ::connect(pool, std::move(session))
+        .then(trace::wrap(trace_t::bind(&::on_reconnect, ph::_1, std::move(resolver), std::move(name), version, pool, std::move(key))));
+}
+
+session_ptr
+on_acquire_attempt(task<session_ptr>::future_move_type future, std::shared_ptr<circuit_breaker_t> breaker) {
+    try {
+        auto session = future.get();
+        breaker->success();
+        return session;
+    } catch (const std::exception&) {
+        breaker->failure();
+        throw;
+    }
 }
 
 void
-on_connect(task<void>::future_move_type future) {
+on_connect_attempt(task<void>::future_move_type future, std::shared_ptr<circuit_breaker_t> breaker) {
     try {
         future.get();
-        CF_DBG("<< connected");
-    } catch (const std::exception& err) {
-        CF_DBG("<< failed to connect: %s", err.what());
+        breaker->success();
+    } catch (const std::exception&) {
+        breaker->failure();
         throw;
     }
 }
 
+void
+on_connect_all(task<std::vector<task<void>::future_type>>::future_move_type future,
+               std::shared_ptr<session_pool_t> pool,
+               std::shared_ptr<serialized_resolver_t> resolver,
+               std::string name)
+{
+    auto futures = future.get();
+
+    std::exception_ptr error;
+    for (auto& future : futures) {
+        try {
+            future.get();
+        } catch (...) {
+            if (!error) {
+                error = std::current_exception();
+            }
+        }
+    }
+
+    // A partially connected pool is still usable, failed sessions are quarantined.
+    if (error && !pool->connected()) {
+        CF_DBG("<< failed to connect");
+        resolver->invalidate(name);
+        std::rethrow_exception(error);
+    }
+
+    CF_DBG("<< connected");
+}
+
+task<void>::future_type
+on_resolve_all(task<void>::future_move_type future,
+               std::shared_ptr<session_pool_t> pool,
+               std::shared_ptr<serialized_resolver_t> resolver,
+               std::string name)
+{
+    future.get();
+
+    std::vector<task<void>::future_type> futures;
+    for (const auto& session : pool->sessions()) {
+        if (!session->connected()) {
+            futures.push_back(pool->connect(session));
+        }
+    }
+
+    return when_all(futures)
+        .then(trace::wrap(trace_t::bind(&::on_connect_all, ph::_1, pool, std::move(resolver), std::move(name))));
+}
+
+/// Moves the pool to the announced or revalidated endpoints and connects the sessions that are not connected
+/// yet, for example the ones to new endpoints in spread mode.
+///
+/// Connected sessions are left as is, they switch to the new endpoints on the next reconnect.
+void
+on_update(const std::string& /* name */,
+          const resolver_t::result_t& info,
+          uint version,
+          std::weak_ptr<session_pool_t> weak)
+{
+    auto pool = weak.lock();
+    if (!pool || !pool->assigned() || info.version != version) {
+        return;
+    }
+
+    pool->assign(info.endpoints);
+
+    for (const auto& session : pool->sessions()) {
+        if (!session->connected()) {
+            CF_DBG(">> pre-connecting ...");
+            pool->connect(session);
+        }
+    }
+}
+
+void
+cancel_timer(std::weak_ptr<asio::deadline_timer> weak) {
+    if (auto timer = weak.lock()) {
+        timer->cancel();
+    }
+}
+
+/// Cancels the hedging timer on the event loop, since timers are not thread-safe.
+void
+on_race_over(scheduler_t& scheduler, std::weak_ptr<asio::deadline_timer> timer) {
+    scheduler(std::bind(&::cancel_timer, std::move(timer)));
+}
+
+void
+on_hedge(const std::error_code& ec,
+         std::shared_ptr<asio::deadline_timer> /* timer */,
+         std::shared_ptr<session_pool_t> pool,
+         std::shared_ptr<basic_race_t> race,
+         std::shared_ptr<task<session_ptr>::promise_type> promise)
+{
+    if (ec || race->completed()) {
+        promise->set_exception(std::system_error(asio::error::operation_aborted));
+        return;
+    }
+
+    // The primary attempt is still acquiring its session, so any session picked now may turn out
+    // to be the same one. There is no invocation to race with yet anyway.
+    const auto primary = race->primary();
+    if (!primary) {
+        CF_DBG("primary attempt has not been sent yet, skipping hedging");
+        promise->set_exception(std::system_error(asio::error::operation_aborted));
+        return;
+    }
+
+    auto session = pool->select_other(primary);
+    if (!session) {
+        CF_DBG("no sessions left for hedging");
+        promise->set_exception(std::system_error(asio::error::not_found));
+        return;
+    }
+
+    CF_DBG(">> hedging ...");
+    promise->set_value(std::move(session));
+}
+
+/// Arms the hedging timer on the event loop, since timers are not thread-safe.
+void
+on_hedge_start(std::shared_ptr<asio::deadline_timer> timer,
+               std::chrono::milliseconds delay,
+               scheduler_t& scheduler,
+               std::shared_ptr<session_pool_t> pool,
+               std::shared_ptr<basic_race_t> race,
+               std::shared_ptr<task<session_ptr>::promise_type> promise)
+{
+    // The pending timer holds the race and the pool, so it's cancelled as soon as the race is over.
+    // The cancellation is posted to the loop as well, thus it can't overtake the timer arming.
+    if (!race->track(std::bind(&::on_race_over, std::ref(scheduler), std::weak_ptr<asio::deadline_timer>(timer)))) {
+        promise->set_exception(std::system_error(asio::error::operation_aborted));
+        return;
+    }
+
+    timer->expires_from_now(boost::posix_time::milliseconds(delay.count()));
+    timer->async_wait(std::bind(&::on_hedge, ph::_1, timer, std::move(pool), std::move(race), promise));
+}
+
+void
+on_deadline(const std::error_code& ec,
+            std::shared_ptr<asio::deadline_timer> /* timer */,
+            std::weak_ptr<basic_gather_t> weak)
+{
+    if (ec) {
+        return;
+    }
+
+    if (auto gather = weak.lock()) {
+        CF_DBG("<< broadcast deadline expired");
+        gather->expire();
+    }
+}
+
+auto on_replicas(task<void>::future_move_type future, std::shared_ptr<session_pool_t> pool)
+    -> std::vector<std::pair<session_t::endpoint_type, session_ptr>>
+{
+    std::exception_ptr error;
+
+    try {
+        future.get();
+    } catch (const std::exception& err) {
+        // Unreachable endpoints get their own errors, unless there are no endpoints at all.
+        if (!pool->assigned()) {
+            throw;
+        }
+
+        CF_DBG("<< broadcasting to partially connected service: %s", err.what());
+        error = std::current_exception();
+    }
+
+    auto replicas = pool->select_all();
+
+    // There is nothing to label with the error, so the whole broadcast fails.
+    if (replicas.empty() && error) {
+        std::rethrow_exception(error);
+    }
+
+    return replicas;
+}
+
 } // namespace
 
 class basic_service_t::impl {
@@ -57,26 +355,74 @@ public:
     uint version;
     scheduler_t& scheduler;
     std::shared_ptr<serialized_resolver_t> resolver;
+    std::shared_ptr<session_pool_t> pool;
+    std::shared_ptr<circuit_breaker_t> breaker;
+    const std::chrono::milliseconds hedge;
+    const bool spread;
+    std::shared_ptr<flight_map_t> flights;
+    std::shared_ptr<response_cache_t> cache;
+    std::uint64_t subscription;
     std::mutex mutex;
 
-    impl(std::string name, uint version, endpoints_t locations, scheduler_t& scheduler) :
+    impl(std::string name,
+         uint version,
+         std::shared_ptr<serialized_resolver_t> resolver,
+         scheduler_t& scheduler,
+         service_options_t options) :
         name(std::move(name)),
         version(version),
         scheduler(scheduler),
-        resolver(std::make_shared<serialized_resolver_t>(std::move(locations), scheduler))
-    {}
+        resolver(std::move(resolver)),
+        pool(std::make_shared<session_pool_t>(options, scheduler)),
+        breaker(std::make_shared<circuit_breaker_t>(options)),
+        hedge(options.hedge),
+        spread(options.spread),
+        flights(options.coalesce ? std::make_shared<flight_map_t>() : nullptr),
+        cache(options.cache.capacity > 0 ? std::make_shared<response_cache_t>(options.cache) : nullptr)
+    {
+        subscription = this->resolver->subscribe(this->name, std::bind(&::on_update, ph::_1, ph::_2, version, std::weak_ptr<session_pool_t>(pool)));
+    }
+
+    ~impl() {
+        // The resolver may be shared with other services and outlive this one.
+        resolver->unsubscribe(name, subscription);
+    }
 };
 
-basic_service_t::basic_service_t(internal_logger_t logger_, std::string name, uint version, endpoints_t locations, scheduler_t& scheduler) :
-    d(new impl(std::move(name), version, std::move(locations), scheduler)),
-    session(std::make_shared<session_t>(scheduler)),
+basic_service_t::basic_service_t(internal_logger_t logger_,
+                                 std::string name,
+                                 uint version,
+                                 endpoints_t locations,
+                                 scheduler_t& scheduler,
+                                 service_options_t options) :
+    d(new impl(std::move(name),
+               version,
+               std::make_shared<serialized_resolver_t>(std::move(locations), scheduler, options.resolve),
+               scheduler,
+               options)),
     scheduler(scheduler),
     logger(std::move(logger_))
 {}
 
+basic_service_t::basic_service_t(internal_logger_t logger_,
+                                 std::string name,
+                                 uint version,
+                                 std::shared_ptr<serialized_resolver_t> resolver,
+                                 scheduler_t& scheduler,
+                                 service_options_t options) :
+    d(new impl(std::move(name), version, std::move(resolver), scheduler, std::move(options))),
+    scheduler(scheduler),
+    logger(std::move(logger_))
+{}
+
+basic_service_t::basic_service_t(const basic_service_t& other) :
+    d(other.d),
+    scheduler(other.scheduler),
+    logger(other.logger)
+{}
+
 basic_service_t::basic_service_t(basic_service_t&& other) :
     d(std::move(other.d)),
-    session(std::move(other.session)),
     scheduler(other.scheduler),
     logger(std::move(other.logger))
 {}
@@ -94,7 +440,7 @@ basic_service_t::version() const noexcept {
 }
 
 auto basic_service_t::hard_shutdown(bool policy) -> void {
-    session->hard_shutdown(policy);
+    d->pool->hard_shutdown(policy);
 }
 
 cocaine::framework::future<void>
@@ -104,24 +450,163 @@ basic_service_t::connect() {
 
     std::lock_guard<std::mutex> lock(d->mutex);
 
-    // Internally the session manages with connection state itself. On any network error it
+    // Internally each session manages with connection state itself. On any network error it
     // should drop its internal state and return false.
-    if (session->connected()) {
-        CF_DBG("already connected");
-        return make_ready_future<void>::value();
+    if (d->pool->assigned()) {
+        const auto sessions = d->pool->sessions();
+        const bool connected = std::all_of(sessions.begin(), sessions.end(), [](const session_ptr& session) {
+            return session->connected();
+        });
+
+        if (connected) {
+            CF_DBG("already connected");
+            return make_ready_future<void>::value();
+        }
+    }
+
+    if (!d->breaker->allow()) {
+        CF_DBG("<< circuit is open");
+        return make_ready_future<void>::error(service_unavailable(d->name));
     }
 
     return d->resolver->resolve(d->name)
-        .then(trace::wrap(trace_t::bind(&::on_resolve, ph::_1, d->version, session)))
-        .then(trace::wrap(trace_t::bind(&::on_connect, ph::_1)));
+        .then(trace::wrap(trace_t::bind(&::on_assign, ph::_1, d->version, d->pool)))
+        .then(trace::wrap(trace_t::bind(&::on_resolve_all, ph::_1, d->pool, d->resolver, d->name)))
+        .then(trace::wrap(trace_t::bind(&::on_connect_attempt, ph::_1, d->breaker)));
+}
+
+cocaine::framework::future<std::shared_ptr<session_t>>
+basic_service_t::acquire(const boost::optional<std::string>& key) {
+    CF_CTX("SC");
+
+    std::lock_guard<std::mutex> lock(d->mutex);
+
+    session_ptr session;
+    if (d->pool->assigned()) {
+        session = ::select(*d->pool, key);
+        if (session && session->connected()) {
+            return make_ready_future<session_ptr>::value(std::move(session));
+        }
+
+        // Quarantined sessions are selected only if there is nothing else, so there is no point
+        // in either reconnecting or resolving the service again until the quarantine expires.
+        if (session) {
+            if (auto error = d->pool->quarantined(session.get())) {
+                CF_DBG("<< all sessions are quarantined");
+                return make_ready_future<session_ptr>::error(error);
+            }
+        }
+    }
+
+    // Fail fast instead of hammering both the Locator and the dead node during an outage.
+    if (!d->breaker->allow()) {
+        CF_DBG("<< circuit is open");
+        return make_ready_future<session_ptr>::error(service_unavailable(d->name));
+    }
+
+    auto future = session ?
+        ::reconnect(d->pool, std::move(session), d->resolver, d->name, d->version, key) :
+        ::resolve(d->resolver, d->name, d->version, d->pool, key);
+
+    return future
+        .then(trace::wrap(trace_t::bind(&::on_acquire_attempt, ph::_1, d->breaker)));
+}
+
+std::shared_ptr<session_t>
+basic_service_t::select(const boost::optional<std::string>& key) {
+    // Sessions are never connected until the service is resolved, so there is no need to lock.
+    auto session = ::select(*d->pool, key);
+    if (session && session->connected()) {
+        return session;
+    }
+
+    return nullptr;
+}
+
+bool
+basic_service_t::hedging() const noexcept {
+    return d->hedge.count() > 0;
+}
+
+std::shared_ptr<flight_map_t>
+basic_service_t::flights() const {
+    return d->flights;
+}
+
+std::shared_ptr<response_cache_t>
+basic_service_t::cache() const {
+    return d->cache;
+}
+
+void
+basic_service_t::invalidate() {
+    if (d->cache) {
+        d->cache->clear();
+    }
+}
+
+cache_stats_t
+basic_service_t::cache_stats() const {
+    if (d->cache) {
+        return d->cache->stats();
+    }
+
+    return cache_stats_t{ 0, 0, 0, 0 };
+}
+
+std::uint64_t
+basic_service_t::suppressed() const {
+    return d->resolver->suppressed(d->name);
+}
+
+cocaine::framework::future<std::shared_ptr<session_t>>
+basic_service_t::hedge(std::shared_ptr<basic_race_t> race) {
+    auto promise = std::make_shared<task<session_ptr>::promise_type>();
+    auto future = promise->get_future();
+
+    auto timer = std::make_shared<asio::deadline_timer>(d->scheduler.loop().loop);
+    d->scheduler(std::bind(&::on_hedge_start, timer, d->hedge, std::ref(d->scheduler), d->pool, std::move(race), promise));
+
+    return future;
+}
+
+cocaine::framework::future<basic_service_t::replicas_t>
+basic_service_t::replicas() {
+    // Without spread mode all sessions connect to the same single endpoint, so a broadcast would
+    // silently reach only one of them.
+    if (!d->spread) {
+        CF_DBG("<< broadcasting requires spread mode");
+        return make_ready_future<replicas_t>::error(std::system_error(asio::error::operation_not_supported));
+    }
+
+    return connect()
+        .then(trace::wrap(trace_t::bind(&::on_replicas, ph::_1, d->pool)));
+}
+
+void
+basic_service_t::expire(std::chrono::milliseconds deadline, std::weak_ptr<basic_gather_t> gather) {
+    // The timer holds the broadcast weakly, so a completed one is freed before the deadline.
+    auto timer = std::make_shared<asio::deadline_timer>(d->scheduler.loop().loop);
+    timer->expires_from_now(boost::posix_time::milliseconds(deadline.count()));
+    timer->async_wait(std::bind(&::on_deadline, ph::_1, timer, std::move(gather)));
 }
 
 boost::optional<session_t::endpoint_type>
 basic_service_t::endpoint() const {
-    return session->endpoint();
+    const auto sessions = d->pool->sessions();
+    if (sessions.empty()) {
+        return boost::none;
+    }
+
+    return sessions.front()->endpoint();
 }
 
 basic_service_t::native_handle_type
 basic_service_t::native_handle() const {
-    return session->native_handle();
+    return d->pool->sessions().at(0)->native_handle();
+}
+
+std::vector<std::size_t>
+basic_service_t::inflight() const {
+    return d->pool->inflight();
 }
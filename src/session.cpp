@@ -137,11 +137,28 @@ session<BasicSession>::native_handle() const {
 }
 
 template<class BasicSession>
-auto session<BasicSession>::invoke(encode_callback_t encode_callback)
+auto session<BasicSession>::inflight() const -> std::size_t {
+    return d->sess->inflight();
+}
+
+template<class BasicSession>
+auto session<BasicSession>::latency() const -> std::chrono::microseconds {
+    return d->sess->latency();
+}
+
+template<class BasicSession>
+auto session<BasicSession>::invoke(encode_ref_t encode_callback)
     -> task<basic_invoke_result>::future_type
 {
     return d->sess->invoke(std::move(encode_callback));
 }
 
+template<class BasicSession>
+auto session<BasicSession>::invoke(std::size_t size, batch_encode_ref_t encode_callback)
+    -> std::vector<task<basic_invoke_result>::future_type>
+{
+    return d->sess->invoke(size, std::move(encode_callback));
+}
+
 #include "cocaine/framework/detail/basic_session.hpp"
 template class cocaine::framework::session<basic_session_t>;
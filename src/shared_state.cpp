@@ -16,11 +16,28 @@
 
 #include "cocaine/framework/detail/shared_state.hpp"
 
+#include <boost/assert.hpp>
+
 using namespace cocaine::framework;
 
+namespace {
+
+/// Checks whether the error is the one the state is broken with when its channel is revoked.
+bool
+revoked(const std::error_code& ec) {
+    return ec == std::errc::operation_canceled;
+}
+
+} // namespace
+
 void shared_state_t::put(value_type&& message) {
     std::unique_lock<std::mutex> lock(mutex);
 
+    // The channel may have been revoked while this message was on its way.
+    if (broken && revoked(*broken)) {
+        return;
+    }
+
     BOOST_ASSERT(!broken);
 
     if (await.empty()) {
@@ -37,6 +54,12 @@ void shared_state_t::put(value_type&& message) {
 void shared_state_t::put(const std::error_code& ec) {
     std::unique_lock<std::mutex> lock(mutex);
 
+    // Either the channel has been revoked before the error arrived, or it is being revoked after
+    // the error.
+    if (broken && (revoked(*broken) || revoked(ec))) {
+        return;
+    }
+
     BOOST_ASSERT(!broken);
 
     broken = ec;
@@ -0,0 +1,347 @@
+/*
+    Copyright (c) 2015 Evgeny Safronov <division494@gmail.com>
+    Copyright (c) 2011-2015 Other contributors as noted in the AUTHORS file.
+    This file is part of Cocaine.
+    Cocaine is free software; you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+    Cocaine is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+    GNU Lesser General Public License for more details.
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "cocaine/framework/detail/snapshot.hpp"
+
+#include <array>
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <mutex>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <boost/lexical_cast.hpp>
+
+#include "cocaine/framework/detail/log.hpp"
+
+using namespace cocaine::framework;
+using namespace cocaine::framework::detail;
+
+namespace {
+
+// The snapshot layout, all integers are in the host byte order:
+//
+//  magic[4] format:u32 count:u32
+//  count * { name_size:u16 name[name_size] version:u32 endpoints:u16 endpoints * endpoint }
+//
+// Each endpoint is encoded as { family:u8 address[4 or 16] port:u16 }, where family is either 4
+// or 6.
+const char MAGIC[4] = { 'C', 'F', 'R', 'S' };
+const std::uint32_t FORMAT = 1;
+
+/// Serializes concurrent writers of the same process.
+std::mutex writing;
+
+class reader_t {
+    const char* data;
+    std::size_t size;
+
+public:
+    reader_t(const char* data, std::size_t size) :
+        data(data),
+        size(size)
+    {}
+
+    auto empty() const -> bool {
+        return size == 0;
+    }
+
+    auto read(std::size_t count) -> const char* {
+        if (count > size) {
+            throw std::runtime_error("snapshot is truncated");
+        }
+
+        const auto result = data;
+        data += count;
+        size -= count;
+        return result;
+    }
+
+    template<class T>
+    auto read() -> T {
+        T value;
+        std::memcpy(&value, read(sizeof(T)), sizeof(T));
+        return value;
+    }
+};
+
+/// Read-only memory mapping of a whole file.
+class mapping_t {
+    int fd;
+    void* data_;
+    std::size_t size_;
+
+public:
+    explicit mapping_t(const std::string& path) :
+        fd(::open(path.c_str(), O_RDONLY)),
+        data_(nullptr),
+        size_(0)
+    {
+        if (fd == -1) {
+            return;
+        }
+
+        struct stat info;
+        if (::fstat(fd, &info) != 0) {
+            ::close(fd);
+            throw std::runtime_error("failed to stat snapshot: " + std::string(std::strerror(errno)));
+        }
+
+        size_ = static_cast<std::size_t>(info.st_size);
+        if (size_ == 0) {
+            return;
+        }
+
+        data_ = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data_ == MAP_FAILED) {
+            data_ = nullptr;
+            ::close(fd);
+            throw std::runtime_error("failed to map snapshot: " + std::string(std::strerror(errno)));
+        }
+    }
+
+    ~mapping_t() {
+        if (data_) {
+            ::munmap(data_, size_);
+        }
+
+        if (fd != -1) {
+            ::close(fd);
+        }
+    }
+
+    mapping_t(const mapping_t&) = delete;
+    mapping_t& operator=(const mapping_t&) = delete;
+
+    auto exists() const -> bool {
+        return fd != -1;
+    }
+
+    auto data() const -> const char* {
+        return static_cast<const char*>(data_);
+    }
+
+    auto size() const -> std::size_t {
+        return data_ ? size_ : 0;
+    }
+};
+
+template<class T>
+void
+write(std::ostream& stream, T value) {
+    stream.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+} // namespace
+
+namespace cocaine { namespace framework { namespace detail {
+
+auto read_snapshot(const std::string& path) -> snapshot_t {
+    const mapping_t mapping(path);
+    if (!mapping.exists()) {
+        return snapshot_t();
+    }
+
+    reader_t reader(mapping.data(), mapping.size());
+
+    if (std::memcmp(reader.read(sizeof(MAGIC)), MAGIC, sizeof(MAGIC)) != 0) {
+        throw std::runtime_error("snapshot has invalid magic");
+    }
+
+    if (reader.read<std::uint32_t>() != FORMAT) {
+        throw std::runtime_error("snapshot has unsupported format");
+    }
+
+    snapshot_t result;
+
+    const auto count = reader.read<std::uint32_t>();
+    for (std::uint32_t id = 0; id < count; ++id) {
+        const auto size = reader.read<std::uint16_t>();
+        std::string name(reader.read(size), size);
+
+        resolver_t::result_t entry;
+        entry.version = reader.read<std::uint32_t>();
+
+        const auto endpoints = reader.read<std::uint16_t>();
+        for (std::uint16_t i = 0; i < endpoints; ++i) {
+            boost::asio::ip::address address;
+
+            switch (reader.read<std::uint8_t>()) {
+            case 4: {
+                boost::asio::ip::address_v4::bytes_type bytes;
+                std::memcpy(bytes.data(), reader.read(bytes.size()), bytes.size());
+                address = boost::asio::ip::address_v4(bytes);
+                break;
+            }
+            case 6: {
+                boost::asio::ip::address_v6::bytes_type bytes;
+                std::memcpy(bytes.data(), reader.read(bytes.size()), bytes.size());
+                address = boost::asio::ip::address_v6(bytes);
+                break;
+            }
+            default:
+                throw std::runtime_error("snapshot has invalid address family");
+            }
+
+            entry.endpoints.emplace_back(address, reader.read<std::uint16_t>());
+        }
+
+        result[std::move(name)] = std::move(entry);
+    }
+
+    if (!reader.empty()) {
+        throw std::runtime_error("snapshot has trailing data");
+    }
+
+    return result;
+}
+
+void
+write_snapshot(const std::string& path, const snapshot_t& snapshot) {
+    // Sizes are checked before anything is written, since truncated ones would corrupt the file.
+    if (snapshot.size() > std::numeric_limits<std::uint32_t>::max()) {
+        throw std::runtime_error("snapshot has too many services");
+    }
+
+    for (const auto& service : snapshot) {
+        if (service.first.size() > std::numeric_limits<std::uint16_t>::max()) {
+            throw std::runtime_error("snapshot service name is too long");
+        }
+
+        if (service.second.endpoints.size() > std::numeric_limits<std::uint16_t>::max()) {
+            throw std::runtime_error("snapshot service '" + service.first + "' has too many endpoints");
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(writing);
+
+    // Readers must never see a partially written file, so it's written aside and then renamed.
+    const auto temporary = path + ".tmp." + boost::lexical_cast<std::string>(::getpid());
+
+    {
+        std::ofstream stream(temporary, std::ios::binary | std::ios::trunc);
+
+        stream.write(MAGIC, sizeof(MAGIC));
+        write<std::uint32_t>(stream, FORMAT);
+        write<std::uint32_t>(stream, snapshot.size());
+
+        for (const auto& service : snapshot) {
+            write<std::uint16_t>(stream, service.first.size());
+            stream.write(service.first.data(), service.first.size());
+            write<std::uint32_t>(stream, service.second.version);
+            write<std::uint16_t>(stream, service.second.endpoints.size());
+
+            for (const auto& endpoint : service.second.endpoints) {
+                const auto address = endpoint.address();
+
+                if (address.is_v4()) {
+                    const auto bytes = address.to_v4().to_bytes();
+                    write<std::uint8_t>(stream, 4);
+                    stream.write(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+                } else {
+                    const auto bytes = address.to_v6().to_bytes();
+                    write<std::uint8_t>(stream, 6);
+                    stream.write(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+                }
+
+                write<std::uint16_t>(stream, endpoint.port());
+            }
+        }
+
+        stream.flush();
+        if (!stream) {
+            std::remove(temporary.c_str());
+            throw std::runtime_error("failed to write snapshot");
+        }
+    }
+
+    if (std::rename(temporary.c_str(), path.c_str()) != 0) {
+        std::remove(temporary.c_str());
+        throw std::runtime_error("failed to replace snapshot: " + std::string(std::strerror(errno)));
+    }
+}
+
+snapshot_writer_t::snapshot_writer_t(std::string path) :
+    path(std::move(path)),
+    version(0),
+    written(0),
+    stopped(false)
+{
+    thread = boost::thread(&snapshot_writer_t::run, this);
+}
+
+snapshot_writer_t::~snapshot_writer_t() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopped = true;
+    }
+
+    cv.notify_one();
+    thread.join();
+}
+
+auto snapshot_writer_t::write(snapshot_t snapshot) -> std::uint64_t {
+    std::uint64_t result;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        pending = std::move(snapshot);
+        result = ++version;
+    }
+
+    cv.notify_one();
+    return result;
+}
+
+void
+snapshot_writer_t::run() {
+    std::unique_lock<std::mutex> lock(mutex);
+
+    while (true) {
+        cv.wait(lock, [&] { return stopped || written < version; });
+
+        if (written == version) {
+            // Stopped with nothing left to write.
+            return;
+        }
+
+        auto snapshot = std::move(pending);
+        pending.clear();
+        const auto current = version;
+
+        lock.unlock();
+
+        try {
+            write_snapshot(path, snapshot);
+            CF_DBG("<< saved the snapshot version %llu", CF_US(current));
+        } catch (const std::exception& err) {
+            CF_DBG("<< failed to save the snapshot version %llu: %s", CF_US(current), err.what());
+        }
+
+        lock.lock();
+        written = current;
+    }
+}
+
+}}} // namespace cocaine::framework::detail
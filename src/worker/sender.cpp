@@ -61,12 +61,28 @@ worker::sender::~sender() {
     }
 }
 
+auto worker::sender::compress(compression_t compression) -> worker::sender& {
+    BOOST_ASSERT(this->session);
+
+    session->compress(std::move(compression));
+    return *this;
+}
+
 auto worker::sender::write(std::string message) -> task<worker::sender>::future_type {
     BOOST_ASSERT(this->session);
 
     auto session = std::move(this->session);
 
-    return session->send<protocol::chunk>(std::move(message))
+    return session->write<protocol::chunk>(message)
+        .then(std::bind(&on_write, ph::_1, session));
+}
+
+auto worker::sender::write(const buffers_t& buffers) -> task<worker::sender>::future_type {
+    BOOST_ASSERT(this->session);
+
+    auto session = std::move(this->session);
+
+    return session->gather<protocol::chunk>(buffers)
         .then(std::bind(&on_write, ph::_1, session));
 }
 
@@ -91,3 +107,59 @@ auto worker::sender::close() -> task<void>::future_type {
     return session->send<protocol::choke>()
         .then(std::bind(&on_close, ph::_1));
 }
+
+auto worker::sender::pipeline(window_t window) -> worker::pipelined_sender {
+    BOOST_ASSERT(this->session);
+
+    return worker::pipelined_sender(
+        std::make_shared<basic_pipeline_t<worker_session_t>>(std::move(this->session), window)
+    );
+}
+
+worker::pipelined_sender::pipelined_sender(std::shared_ptr<basic_pipeline_t<worker_session_t>> d) :
+    d(std::move(d))
+{}
+
+worker::pipelined_sender::~pipelined_sender() {
+    if (d) {
+        close();
+    }
+}
+
+auto worker::pipelined_sender::write(std::string message) -> task<void>::future_type {
+    BOOST_ASSERT(this->d);
+
+    return d->slice<protocol::chunk>(message);
+}
+
+auto worker::pipelined_sender::write(const buffers_t& buffers) -> task<void>::future_type {
+    BOOST_ASSERT(this->d);
+
+    return d->gather<protocol::chunk>(buffers);
+}
+
+auto worker::pipelined_sender::error(int ec, std::string reason) -> task<void>::future_type {
+    return error(std::error_code(ec, cocaine::service::node::worker_user_category()), std::move(reason));
+}
+
+auto worker::pipelined_sender::error(std::error_code ec, std::string reason) -> task<void>::future_type {
+    BOOST_ASSERT(this->d);
+
+    auto d = std::move(this->d);
+    d->push<protocol::error>(ec, std::move(reason));
+    return d->flush();
+}
+
+auto worker::pipelined_sender::close() -> task<void>::future_type {
+    BOOST_ASSERT(this->d);
+
+    auto d = std::move(this->d);
+    d->push<protocol::choke>();
+    return d->flush();
+}
+
+auto worker::pipelined_sender::flush() -> task<void>::future_type {
+    BOOST_ASSERT(this->d);
+
+    return d->flush();
+}
@@ -27,6 +27,7 @@
 
 #include "cocaine/framework/detail/log.hpp"
 #include "cocaine/framework/detail/loop.hpp"
+#include "cocaine/framework/detail/recycle.hpp"
 #include "cocaine/framework/detail/shared_state.hpp"
 
 namespace ph = std::placeholders;
@@ -40,6 +41,9 @@ const std::uint64_t CONTROL_CHANNEL_ID = 1;
 const boost::posix_time::time_duration HEARTBEAT_TIMEOUT = boost::posix_time::seconds(10);
 const boost::posix_time::time_duration DISOWN_TIMEOUT = boost::posix_time::seconds(60);
 
+// Heartbeats never change, so they are encoded once.
+const prepared<io::worker::heartbeat> HEARTBEAT;
+
 //! \note single shot.
 template<class Session>
 class worker_session_t::push_t : public std::enable_shared_from_this<push_t<Session>> {
@@ -110,7 +114,8 @@ worker_session_t::push(io::encoder_t::message_type&& message) {
     scheduler(
         std::bind(
             &push_t<worker_session_t>::operator(),
-            std::make_shared<push_t<worker_session_t>>(
+            std::allocate_shared<push_t<worker_session_t>>(
+                detail::recycling_allocator<push_t<worker_session_t>>(),
                 std::move(message), shared_from_this(), std::move(pr)
             )
         )
@@ -119,6 +124,11 @@ worker_session_t::push(io::encoder_t::message_type&& message) {
     return fr;
 }
 
+future<void>
+worker_session_t::push(std::uint64_t, io::encoder_t::message_type&& message) {
+    return push(std::move(message));
+}
+
 void
 worker_session_t::revoke(std::uint64_t span) {
     CF_DBG("revoking span %llu channel", CF_US(span));
@@ -161,7 +171,7 @@ void worker_session_t::exhale(const std::error_code& ec) {
 
     CF_DBG("<- ♥");
 
-    push(io::encoded<io::worker::heartbeat>(CONTROL_CHANNEL_ID));
+    push(HEARTBEAT.encode(CONTROL_CHANNEL_ID));
 
     heartbeat_timer.expires_from_now(HEARTBEAT_TIMEOUT);
     heartbeat_timer.async_wait(std::bind(&worker_session_t::exhale, shared_from_this(), ph::_1));
@@ -332,4 +342,5 @@ void worker_session_t::process_invoke(std::map<std::uint64_t, std::shared_ptr<sh
 #include "../receiver.cpp"
 
 template class cocaine::framework::basic_sender_t<worker_session_t>;
+template class cocaine::framework::basic_pipeline_t<worker_session_t>;
 template class cocaine::framework::basic_receiver_t<worker_session_t>;
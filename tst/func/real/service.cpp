@@ -1,3 +1,5 @@
+#include <thread>
+
 #include <gtest/gtest.h>
 
 #include <cocaine/common.hpp>
@@ -13,11 +15,32 @@
 
 using namespace cocaine::framework;
 
+namespace cocaine { namespace framework {
+
+template<>
+struct idempotent<io::storage::read> : public std::true_type {};
+
+}} // namespace cocaine::framework
+
 using namespace testing;
 using namespace testing::util;
 
 #include <cocaine/framework/manager.hpp>
 
+namespace {
+
+// Locator host names are resolved asynchronously, so wait for the first round to complete.
+std::vector<boost::asio::ip::tcp::endpoint>
+wait_endpoints(const service_manager_t& manager) {
+    for (int attempt = 0; attempt < 500 && manager.endpoints().empty(); ++attempt) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+
+    return manager.endpoints();
+}
+
+} // namespace
+
 #ifdef __clang__
 
 TEST(service_manager, MultipleLocations) {
@@ -26,7 +49,7 @@ TEST(service_manager, MultipleLocations) {
         {boost::asio::ip::address_v6({0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1}), 10053},
         {boost::asio::ip::address_v4({127, 0, 0, 1}), 10053}
     };
-    EXPECT_EQ(endpoints, manager.endpoints());
+    EXPECT_EQ(endpoints, wait_endpoints(manager));
 }
 
 TEST(service_manager, MoreMultipleLocations) {
@@ -39,11 +62,15 @@ TEST(service_manager, MoreMultipleLocations) {
         {boost::asio::ip::address_v4({127, 0, 0, 1}), 10053},
         {boost::asio::ip::address_v4({127, 0, 0, 1}), 10054}
     };
-    EXPECT_EQ(endpoints, manager.endpoints());
+    EXPECT_EQ(endpoints, wait_endpoints(manager));
 }
 
-TEST(service_manager, ThrowsOnInvalidFqdn) {
-    EXPECT_THROW(service_manager_t manager({std::make_tuple("wtf", 10053)}, 1), std::exception);
+TEST(service_manager, FailsToConnectOnInvalidFqdn) {
+    service_manager_t manager({std::make_tuple("wtf", 10053)}, 1);
+    auto service = manager.create<cocaine::io::storage_tag>("storage");
+
+    EXPECT_THROW(service.connect().get(), std::exception);
+    EXPECT_TRUE(manager.endpoints().empty());
 }
 
 TEST(service, NotFound) {
@@ -53,6 +80,41 @@ TEST(service, NotFound) {
     EXPECT_THROW(service.connect().get(), service_not_found);
 }
 
+TEST(service, CircuitDisabledByDefault) {
+    service_manager_t manager(1);
+    auto service = manager.create<cocaine::io::app_tag>("invalid");
+
+    for (int id = 0; id < 10; ++id) {
+        EXPECT_THROW(service.connect().get(), service_not_found);
+    }
+}
+
+TEST(service, CircuitOpensAfterRepeatedFailures) {
+    service_options_t options;
+    options.threshold = 2;
+
+    service_manager_t manager(1);
+    auto service = manager.create<cocaine::io::app_tag>("invalid", options);
+
+    EXPECT_THROW(service.connect().get(), service_not_found);
+    EXPECT_THROW(service.connect().get(), service_not_found);
+    EXPECT_THROW(service.connect().get(), service_unavailable);
+}
+
+TEST(service, NotFoundCachedNegatively) {
+    service_options_t options;
+    options.resolve.negative = std::chrono::milliseconds(60000);
+
+    service_manager_t manager(1);
+    auto service = manager.create<cocaine::io::app_tag>("invalid", options);
+
+    EXPECT_THROW(service.connect().get(), service_not_found);
+    EXPECT_EQ(0, service.suppressed());
+
+    EXPECT_THROW(service.connect().get(), service_not_found);
+    EXPECT_EQ(1, service.suppressed());
+}
+
 TEST(service, ConnectionRefusedOnWrongLocator) {
     service_manager_t manager({{boost::asio::ip::tcp::v6(), 10052}}, 1);
     auto service = manager.create<cocaine::io::app_tag>("node");
@@ -104,6 +166,158 @@ TEST(service, StorageRead) {
     EXPECT_EQ("le value", result);
 }
 
+TEST(service, StorageShared) {
+    service_manager_t manager(1);
+    auto lhs = manager.create<cocaine::io::storage_tag>("storage");
+    auto rhs = manager.create<cocaine::io::storage_tag>("storage");
+
+    lhs.connect().get();
+
+    EXPECT_TRUE(!!rhs.endpoint());
+    EXPECT_EQ(lhs.native_handle(), rhs.native_handle());
+    EXPECT_EQ("le value", rhs.invoke<cocaine::io::storage::read>("collection", "key").get());
+}
+
+TEST(service, StorageReadPooled) {
+    service_options_t options;
+    options.pool = 4;
+
+    service_manager_t manager(1);
+    auto storage = manager.create<cocaine::io::storage_tag>("storage", options);
+    storage.connect().get();
+
+    std::vector<task<std::string>::future_type> futures;
+    for (int id = 0; id < 16; ++id) {
+        futures.push_back(storage.invoke<cocaine::io::storage::read>("collection", "key"));
+    }
+
+    for (auto& future : futures) {
+        EXPECT_EQ("le value", future.get());
+    }
+
+    EXPECT_EQ(4, storage.inflight().size());
+}
+
+TEST(service, StorageReadSpread) {
+    service_options_t options;
+    options.spread = true;
+
+    service_manager_t manager(1);
+    auto storage = manager.create<cocaine::io::storage_tag>("storage", options);
+    storage.connect().get();
+
+    for (int id = 0; id < 16; ++id) {
+        EXPECT_EQ("le value", storage.invoke<cocaine::io::storage::read>("collection", "key").get());
+    }
+
+    EXPECT_FALSE(storage.inflight().empty());
+}
+
+TEST(service, StorageReadRouted) {
+    service_options_t options;
+    options.pool = 2;
+    options.spread = true;
+
+    service_manager_t manager(1);
+    auto storage = manager.create<cocaine::io::storage_tag>("storage", options);
+
+    // The first routed invocation resolves the service itself.
+    EXPECT_EQ("le value", storage.route<cocaine::io::storage::read>("key", "collection", "key").get());
+
+    std::vector<task<std::string>::future_type> futures;
+    for (int id = 0; id < 16; ++id) {
+        futures.push_back(storage.route<cocaine::io::storage::read>(std::to_string(id), "collection", "key"));
+    }
+
+    for (auto& future : futures) {
+        EXPECT_EQ("le value", future.get());
+    }
+
+    EXPECT_EQ(0, storage.inflight().size() % 2);
+}
+
+TEST(service, StorageReadHedged) {
+    service_options_t options;
+    options.pool = 2;
+    options.hedge = std::chrono::milliseconds(1);
+
+    service_manager_t manager(1);
+    auto storage = manager.create<cocaine::io::storage_tag>("storage", options);
+    storage.connect().get();
+
+    for (int id = 0; id < 16; ++id) {
+        EXPECT_EQ("le value", storage.invoke<cocaine::io::storage::read>("collection", "key").get());
+    }
+}
+
+TEST(service, StorageReadCoalesced) {
+    service_options_t options;
+    options.coalesce = true;
+
+    service_manager_t manager(1);
+    auto storage = manager.create<cocaine::io::storage_tag>("storage", options);
+    storage.connect().get();
+
+    std::vector<task<std::string>::future_type> futures;
+    for (int id = 0; id < 16; ++id) {
+        futures.push_back(storage.invoke<cocaine::io::storage::read>("collection", "key"));
+    }
+
+    for (auto& future : futures) {
+        EXPECT_EQ("le value", future.get());
+    }
+}
+
+TEST(service, StorageReadCached) {
+    service_options_t options;
+    options.cache.capacity = 1024 * 1024;
+    options.cache.expire<cocaine::io::storage::read>(std::chrono::seconds(60));
+
+    service_manager_t manager(1);
+    auto storage = manager.create<cocaine::io::storage_tag>("storage", options);
+
+    EXPECT_EQ("le value", storage.invoke<cocaine::io::storage::read>("collection", "key").get());
+    EXPECT_EQ("le value", storage.invoke<cocaine::io::storage::read>("collection", "key").get());
+    EXPECT_EQ(1, storage.cache_stats().hits);
+    EXPECT_EQ(1, storage.cache_stats().misses);
+    EXPECT_EQ(1, storage.cache_stats().entries);
+
+    storage.invalidate<cocaine::io::storage::read>(std::string("collection"), std::string("key"));
+
+    EXPECT_EQ("le value", storage.invoke<cocaine::io::storage::read>("collection", "key").get());
+    EXPECT_EQ(2, storage.cache_stats().misses);
+}
+
+TEST(service, StorageReadBatch) {
+    service_manager_t manager(1);
+    auto storage = manager.create<cocaine::io::storage_tag>("storage");
+    storage.connect().get();
+
+    const std::vector<std::tuple<std::string, std::string>> batch(16, std::make_tuple("collection", "key"));
+
+    auto futures = storage.batch<cocaine::io::storage::read>(batch);
+    ASSERT_EQ(16, futures.size());
+
+    for (auto& future : futures) {
+        EXPECT_EQ("le value", future.get());
+    }
+}
+
+TEST(service, StorageReadBroadcast) {
+    service_options_t options;
+    options.spread = true;
+
+    service_manager_t manager(1);
+    auto storage = manager.create<cocaine::io::storage_tag>("storage", options);
+
+    auto replies = storage.broadcast<cocaine::io::storage::read>(std::chrono::seconds(5), "collection", "key").get();
+    ASSERT_FALSE(replies.empty());
+
+    for (auto& reply : replies) {
+        EXPECT_EQ("le value", reply.result.get());
+    }
+}
+
 TEST(service, StorageError) {
     service_manager_t manager(1);
     auto storage = manager.create<cocaine::io::storage_tag>("storage");
@@ -0,0 +1,64 @@
+#include <gtest/gtest.h>
+
+#include <cocaine/framework/service/cache.hpp>
+
+using namespace cocaine::framework;
+using namespace cocaine::framework::detail;
+
+TEST(response_cache_t, InvalidationRejectsInFlightResponseOfSameKey) {
+    cache_options_t options;
+    options.capacity = 1024;
+    response_cache_t cache(options);
+
+    const auto lhs = cache.begin("lhs");
+    const auto rhs = cache.begin("rhs");
+
+    cache.erase("lhs");
+
+    cache.put("lhs", "stale", std::chrono::seconds(60), lhs);
+    cache.put("rhs", "fresh", std::chrono::seconds(60), rhs);
+
+    EXPECT_FALSE(cache.get("lhs"));
+    ASSERT_TRUE(!!cache.get("rhs"));
+    EXPECT_EQ("fresh", *cache.get("rhs"));
+}
+
+TEST(response_cache_t, ClearRejectsAllInFlightResponses) {
+    cache_options_t options;
+    options.capacity = 1024;
+    response_cache_t cache(options);
+
+    const auto lhs = cache.begin("lhs");
+    const auto rhs = cache.begin("rhs");
+
+    cache.clear();
+
+    cache.put("lhs", "stale", std::chrono::seconds(60), lhs);
+    cache.put("rhs", "stale", std::chrono::seconds(60), rhs);
+
+    EXPECT_FALSE(cache.get("lhs"));
+    EXPECT_FALSE(cache.get("rhs"));
+}
+
+TEST(response_cache_t, InvocationsStartedAfterInvalidationAreCached) {
+    cache_options_t options;
+    options.capacity = 1024;
+    response_cache_t cache(options);
+
+    const auto stale = cache.begin("key");
+    cache.erase("key");
+    const auto fresh = cache.begin("key");
+
+    cache.put("key", "stale", std::chrono::seconds(60), stale);
+    EXPECT_FALSE(cache.get("key"));
+
+    cache.put("key", "fresh", std::chrono::seconds(60), fresh);
+    ASSERT_TRUE(!!cache.get("key"));
+    EXPECT_EQ("fresh", *cache.get("key"));
+
+    // A failed invocation leaves nothing pending, so the next one starts from scratch.
+    cache.begin("key");
+    cache.cancel("key");
+    cache.put("key", "orphan", std::chrono::seconds(60), cache.begin("key"));
+    EXPECT_EQ("orphan", *cache.get("key"));
+}
@@ -0,0 +1,88 @@
+#include <cstdint>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <cocaine/idl/locator.hpp>
+#include <cocaine/idl/streaming.hpp>
+
+#include <cocaine/framework/encoder.hpp>
+#include <cocaine/framework/message.hpp>
+
+#include <cocaine/framework/detail/decoder.hpp>
+#include <cocaine/framework/detail/deflate.hpp>
+
+using namespace cocaine::framework;
+
+TEST(Encoder, GatheredEvent) {
+    typedef cocaine::io::protocol<cocaine::io::streaming_tag<std::string>>::scope protocol;
+
+    const buffers_t buffers = {{ asio::buffer("le ", 3), asio::buffer("message", 7) }};
+    gathered<protocol::chunk> message(1, buffers);
+    cocaine::io::encoded<protocol::chunk> expected(1, std::string("le message"));
+
+    EXPECT_EQ(std::string(expected.data(), expected.size()), std::string(message.data(), message.size()));
+}
+
+TEST(Encoder, GatheredEmptyEvent) {
+    typedef cocaine::io::protocol<cocaine::io::streaming_tag<std::string>>::scope protocol;
+
+    gathered<protocol::chunk> message(1, buffers_t());
+    cocaine::io::encoded<protocol::chunk> expected(1, std::string());
+
+    EXPECT_EQ(std::string(expected.data(), expected.size()), std::string(message.data(), message.size()));
+}
+
+TEST(Encoder, PreparedEvent) {
+    const prepared<cocaine::io::locator::resolve> event(std::string("node"));
+
+    const std::vector<std::uint8_t> expected = {{ 147, 1, 0, 145, 164, 110, 111, 100, 101 }};
+
+    const auto message = event.encode(1);
+    EXPECT_EQ(expected, std::vector<std::uint8_t>(message.data(), message.data() + message.size()));
+}
+
+TEST(Encoder, PreparedEventWithLargeSpan) {
+    const prepared<cocaine::io::locator::resolve> event(std::string("node"));
+    cocaine::io::encoded<cocaine::io::locator::resolve> expected(100500, std::string("node"));
+
+    const auto message = event.encode(100500);
+    EXPECT_EQ(std::string(expected.data(), expected.size()), std::string(message.data(), message.size()));
+}
+
+TEST(Encoder, DeflateRoundTrip) {
+    const std::string payload(64 * 1024, 'x');
+
+    const auto compressed = detail::deflate(payload.data(), payload.size(), 1);
+    EXPECT_LT(compressed.size(), payload.size());
+    EXPECT_EQ(payload, detail::inflate(compressed.data(), compressed.size()));
+    EXPECT_THROW(detail::inflate(payload.data(), payload.size()), std::runtime_error);
+}
+
+TEST(Encoder, InflateRejectsPayloadOverLimit) {
+    const std::string payload(64 * 1024, 'x');
+
+    const auto compressed = detail::deflate(payload.data(), payload.size(), 1);
+    EXPECT_EQ(payload, detail::inflate(compressed.data(), compressed.size(), payload.size()));
+    EXPECT_THROW(detail::inflate(compressed.data(), compressed.size(), payload.size() - 1), std::runtime_error);
+}
+
+TEST(Decoder, DeflatedMessage) {
+    const std::string payload(64 * 1024, 'x');
+    const auto message = detail::deflated(42, 0, payload.data(), payload.size(), 1);
+
+    detail::decoder_t decoder;
+    decoded_message decoded(boost::none);
+    std::error_code ec;
+
+    EXPECT_EQ(message.size(), decoder.decode(message.data(), message.size(), decoded, ec));
+    ASSERT_FALSE(ec);
+
+    EXPECT_EQ(42, decoded.span());
+    EXPECT_EQ(0, decoded.type());
+    EXPECT_EQ(payload, decoded.args().via.array.ptr[0].as<std::string>());
+
+    // Headers refer to the received buffer, which must outlive the decoding.
+    ASSERT_EQ(1, decoded.meta().size());
+    EXPECT_TRUE(detail::compressed(decoded.meta()));
+}
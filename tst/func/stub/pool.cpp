@@ -0,0 +1,182 @@
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <cocaine/framework/forwards.hpp>
+#include <cocaine/framework/scheduler.hpp>
+
+#include <cocaine/framework/detail/loop.hpp>
+#include <cocaine/framework/detail/pool.hpp>
+
+#include "../../util/net.hpp"
+
+using namespace testing;
+using namespace testing::util;
+
+using namespace cocaine::framework;
+using namespace cocaine::framework::detail;
+
+namespace {
+
+typedef session_pool_t::endpoint_type endpoint_type;
+
+auto make_endpoints(std::size_t size) -> std::vector<endpoint_type> {
+    std::vector<endpoint_type> result;
+    for (std::size_t id = 0; id < size; ++id) {
+        result.emplace_back(boost::asio::ip::address::from_string("127.0.0.1"), 10000 + id);
+    }
+
+    return result;
+}
+
+auto make_options(std::size_t pool) -> service_options_t {
+    service_options_t options;
+    options.pool = pool;
+    options.spread = true;
+    return options;
+}
+
+/// Returns the endpoint of the given session, knowing that in spread mode the pool keeps
+/// `options.pool` sessions per endpoint in the order endpoints have been assigned.
+auto endpoint_of(const session_pool_t& pool,
+                 const std::vector<endpoint_type>& assigned,
+                 std::size_t size,
+                 const std::shared_ptr<session_t>& session) -> endpoint_type
+{
+    const auto sessions = pool.sessions();
+    for (std::size_t id = 0; id < sessions.size(); ++id) {
+        if (sessions[id].get() == session.get()) {
+            return assigned.at(id / size);
+        }
+    }
+
+    throw std::logic_error("session doesn't belong to the pool");
+}
+
+/// Routes each key once, releasing the selected session before routing the next one.
+auto route(session_pool_t& pool,
+           const std::vector<endpoint_type>& assigned,
+           std::size_t size,
+           const std::vector<std::string>& keys) -> std::map<std::string, endpoint_type>
+{
+    std::map<std::string, endpoint_type> result;
+    for (const auto& key : keys) {
+        result[key] = endpoint_of(pool, assigned, size, pool.select(key));
+    }
+
+    return result;
+}
+
+auto make_keys(std::size_t size) -> std::vector<std::string> {
+    std::vector<std::string> result;
+    for (std::size_t id = 0; id < size; ++id) {
+        result.push_back("key-" + std::to_string(id));
+    }
+
+    return result;
+}
+
+} // namespace
+
+TEST(session_pool_t, SameKeyGoesToSameEndpoint) {
+    client_t client;
+    event_loop_t loop { client.loop() };
+    scheduler_t scheduler(loop);
+
+    const auto endpoints = make_endpoints(4);
+    const auto keys = make_keys(256);
+
+    auto pool = std::make_shared<session_pool_t>(make_options(2), scheduler);
+    pool->assign(endpoints);
+
+    const auto first = route(*pool, endpoints, 2, keys);
+    const auto second = route(*pool, endpoints, 2, keys);
+
+    EXPECT_EQ(first, second);
+
+    // Keys are spread over all endpoints.
+    std::set<endpoint_type> used;
+    for (const auto& item : first) {
+        used.insert(item.second);
+    }
+
+    EXPECT_EQ(endpoints.size(), used.size());
+}
+
+TEST(session_pool_t, RingIsIdenticalAcrossPools) {
+    client_t client;
+    event_loop_t loop { client.loop() };
+    scheduler_t scheduler(loop);
+
+    const auto endpoints = make_endpoints(4);
+    const std::vector<endpoint_type> shuffled = { endpoints[3], endpoints[1], endpoints[0], endpoints[2] };
+    const auto keys = make_keys(256);
+
+    auto lhs = std::make_shared<session_pool_t>(make_options(1), scheduler);
+    auto rhs = std::make_shared<session_pool_t>(make_options(3), scheduler);
+    lhs->assign(endpoints);
+    rhs->assign(shuffled);
+
+    // Neither the order of endpoints nor the number of sessions per endpoint affect the ring.
+    EXPECT_EQ(route(*lhs, endpoints, 1, keys), route(*rhs, shuffled, 3, keys));
+}
+
+TEST(session_pool_t, RemovedEndpointMovesOnlyItsKeys) {
+    client_t client;
+    event_loop_t loop { client.loop() };
+    scheduler_t scheduler(loop);
+
+    const auto endpoints = make_endpoints(4);
+    const std::vector<endpoint_type> remaining(endpoints.begin(), endpoints.end() - 1);
+    const auto keys = make_keys(256);
+
+    auto pool = std::make_shared<session_pool_t>(make_options(1), scheduler);
+
+    pool->assign(endpoints);
+    const auto before = route(*pool, endpoints, 1, keys);
+
+    pool->assign(remaining);
+    const auto after = route(*pool, remaining, 1, keys);
+
+    for (const auto& key : keys) {
+        if (before.at(key) != endpoints.back()) {
+            EXPECT_EQ(before.at(key), after.at(key));
+        }
+    }
+}
+
+TEST(session_pool_t, BoundSpillsHotKeyOntoOtherEndpoints) {
+    client_t client;
+    event_loop_t loop { client.loop() };
+    scheduler_t scheduler(loop);
+
+    const auto endpoints = make_endpoints(4);
+
+    auto pool = std::make_shared<session_pool_t>(make_options(1), scheduler);
+    pool->assign(endpoints);
+
+    const auto home = endpoint_of(*pool, endpoints, 1, pool->select("hot"));
+
+    // Selected sessions are accounted as outstanding invocations until released.
+    std::vector<std::shared_ptr<session_t>> leases;
+    std::map<endpoint_type, std::size_t> loads;
+    for (int id = 0; id < 16; ++id) {
+        leases.push_back(pool->select("hot"));
+        ++loads[endpoint_of(*pool, endpoints, 1, leases.back())];
+    }
+
+    EXPECT_EQ(home, endpoint_of(*pool, endpoints, 1, leases.front()));
+    EXPECT_LT(1, loads.size());
+
+    // No endpoint exceeds the bound of 1.25 times the average load.
+    for (const auto& load : loads) {
+        EXPECT_LE(load.second, 5);
+    }
+
+    // Once the load goes away, the key returns home.
+    leases.clear();
+    EXPECT_EQ(home, endpoint_of(*pool, endpoints, 1, pool->select("hot")));
+}
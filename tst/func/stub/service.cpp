@@ -0,0 +1,343 @@
+#include <mutex>
+#include <thread>
+
+#include <gtest/gtest.h>
+
+#include <cocaine/idl/node.hpp>
+#include <cocaine/idl/storage.hpp>
+#include <cocaine/idl/streaming.hpp>
+
+#include <cocaine/framework/error.hpp>
+#include <cocaine/framework/manager.hpp>
+#include <cocaine/framework/service.hpp>
+
+#include "../../util/stub.hpp"
+
+using namespace cocaine::framework;
+
+namespace cocaine { namespace framework {
+
+template<>
+struct idempotent<io::storage::read> : public std::true_type {};
+
+}} // namespace cocaine::framework
+
+using namespace testing;
+using namespace testing::util;
+
+namespace {
+
+const unsigned int STORAGE_VERSION = cocaine::io::protocol<cocaine::io::storage_tag>::version::value;
+const unsigned int APP_VERSION = cocaine::io::protocol<cocaine::io::app_tag>::version::value;
+
+/// Returns a handler of a stub Storage, which replies to each read after the delay.
+stub_t::handler_type
+storage(std::chrono::milliseconds delay, std::string value = "le value") {
+    return [=](std::shared_ptr<stub_connection_t> connection, std::uint64_t span, std::uint64_t, const msgpack::object&) {
+        connection->delayed<cocaine::io::storage::read>(delay, span, value);
+    };
+}
+
+/// Records event ids and string arguments of all messages received by a stub.
+class recorder_t {
+    std::vector<std::pair<std::uint64_t, std::string>> messages;
+    std::mutex mutex;
+
+public:
+    stub_t::handler_type
+    handler() {
+        return [this](std::shared_ptr<stub_connection_t>, std::uint64_t, std::uint64_t id, const msgpack::object& args) {
+            std::string data;
+            if (args.via.array.size > 0 && args.via.array.ptr[0].type == msgpack::type::RAW) {
+                data = args.via.array.ptr[0].as<std::string>();
+            }
+
+            std::lock_guard<std::mutex> lock(mutex);
+            messages.emplace_back(id, std::move(data));
+        };
+    }
+
+    /// Waits for the given number of messages to arrive.
+    std::vector<std::pair<std::uint64_t, std::string>>
+    wait(std::size_t count) {
+        for (int attempt = 0; attempt < 100; ++attempt) {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (messages.size() >= count) {
+                    return messages;
+                }
+            }
+
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+
+        std::lock_guard<std::mutex> lock(mutex);
+        return messages;
+    }
+};
+
+} // namespace
+
+TEST(service, CoalescedInvocationsShareUpstream) {
+    stub_t backend(storage(std::chrono::milliseconds(200)));
+    stub_t locator(util::locator({{ "storage", stub_service_t({ backend.endpoint() }, STORAGE_VERSION) }}));
+
+    service_options_t options;
+    options.coalesce = true;
+
+    service_manager_t manager({ locator.endpoint() }, 1);
+    auto service = manager.create<cocaine::io::storage_tag>("storage", options);
+    service.connect().get();
+
+    // The response is delayed, so all invocations are made while the first one is in flight.
+    std::vector<task<std::string>::future_type> futures;
+    for (int id = 0; id < 16; ++id) {
+        futures.push_back(service.invoke<cocaine::io::storage::read>("collection", "key"));
+    }
+
+    for (auto& future : futures) {
+        EXPECT_EQ("le value", future.get());
+    }
+
+    EXPECT_EQ(1, backend.invocations());
+
+    // Different arguments are not joined.
+    EXPECT_EQ("le value", service.invoke<cocaine::io::storage::read>("collection", "other").get());
+    EXPECT_EQ(2, backend.invocations());
+}
+
+TEST(service, PipelinedChunksArriveInOrder) {
+    typedef cocaine::io::protocol<cocaine::io::app::enqueue::dispatch_type>::scope upstream;
+
+    recorder_t recorder;
+    stub_t backend(recorder.handler());
+    stub_t locator(util::locator({{ "echo", stub_service_t({ backend.endpoint() }, APP_VERSION) }}));
+
+    service_manager_t manager({ locator.endpoint() }, 1);
+    auto echo = manager.create<cocaine::io::app_tag>("echo");
+
+    auto channel = echo.invoke<cocaine::io::app::enqueue>("ping").get();
+
+    // The window is smaller than the stream, so most chunks wait in the queue.
+    window_t window;
+    window.chunks = 2;
+    window.bytes = 256;
+    auto tx = channel.tx.pipeline(window);
+
+    for (int id = 0; id < 64; ++id) {
+        tx.write(std::to_string(id) + std::string(100, 'x')).get();
+    }
+    tx.close().get();
+
+    const auto messages = recorder.wait(1 + 64 + 1);
+    ASSERT_EQ(1 + 64 + 1, messages.size());
+
+    EXPECT_EQ("ping", messages.front().second);
+    for (int id = 0; id < 64; ++id) {
+        EXPECT_EQ(cocaine::io::event_traits<upstream::chunk>::id, messages[1 + id].first);
+        EXPECT_EQ(std::to_string(id) + std::string(100, 'x'), messages[1 + id].second);
+    }
+    EXPECT_EQ(cocaine::io::event_traits<upstream::choke>::id, messages.back().first);
+}
+
+TEST(service, PipelineBreaksOnWriteError) {
+    // The backend drops the connection as soon as the invocation arrives.
+    stub_t backend([](std::shared_ptr<stub_connection_t> connection, std::uint64_t, std::uint64_t, const msgpack::object&) {
+        connection->close();
+    });
+    stub_t locator(util::locator({{ "echo", stub_service_t({ backend.endpoint() }, APP_VERSION) }}));
+
+    service_manager_t manager({ locator.endpoint() }, 1);
+    auto echo = manager.create<cocaine::io::app_tag>("echo");
+
+    auto channel = echo.invoke<cocaine::io::app::enqueue>("ping").get();
+    auto tx = channel.tx.pipeline();
+
+    bool broken = false;
+    for (int id = 0; id < 100 && !broken; ++id) {
+        try {
+            tx.write("chunk").get();
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        } catch (const std::exception&) {
+            broken = true;
+        }
+    }
+
+    // Once broken, the pipeline reports the first error to all subsequent calls.
+    EXPECT_THROW(tx.flush().get(), std::exception);
+    EXPECT_THROW(tx.write("chunk").get(), std::exception);
+    EXPECT_THROW(tx.close().get(), std::exception);
+}
+
+TEST(service, PipelineRejectsEmptyWindow) {
+    stub_t backend([](std::shared_ptr<stub_connection_t>, std::uint64_t, std::uint64_t, const msgpack::object&) {});
+    stub_t locator(util::locator({{ "echo", stub_service_t({ backend.endpoint() }, APP_VERSION) }}));
+
+    service_manager_t manager({ locator.endpoint() }, 1);
+    auto echo = manager.create<cocaine::io::app_tag>("echo");
+
+    window_t chunks;
+    chunks.chunks = 0;
+    EXPECT_THROW(echo.invoke<cocaine::io::app::enqueue>("ping").get().tx.pipeline(chunks), std::invalid_argument);
+
+    window_t bytes;
+    bytes.bytes = 0;
+    EXPECT_THROW(echo.invoke<cocaine::io::app::enqueue>("ping").get().tx.pipeline(bytes), std::invalid_argument);
+}
+
+TEST(service, ManagerResolveOptionsApplyToSharedServices) {
+    stub_t locator(util::locator({}));
+
+    service_manager_t manager({ locator.endpoint() }, 1);
+
+    resolve_options_t options;
+    options.negative = std::chrono::milliseconds(60000);
+    manager.resolve_options(options);
+
+    auto storage = manager.create<cocaine::io::storage_tag>("storage");
+
+    EXPECT_THROW(storage.invoke<cocaine::io::storage::read>("collection", "key").get(), service_not_found);
+    EXPECT_THROW(storage.invoke<cocaine::io::storage::read>("collection", "key").get(), service_not_found);
+
+    // The second miss is served from the negative cache without asking the Locator.
+    EXPECT_EQ(1, locator.invocations());
+}
+
+TEST(service, DedicatedServicesShareLocatorConnection) {
+    stub_t backend(storage(std::chrono::milliseconds(0)));
+    stub_t locator(util::locator({
+        { "storage", stub_service_t({ backend.endpoint() }, STORAGE_VERSION) },
+        { "storage-replica", stub_service_t({ backend.endpoint() }, STORAGE_VERSION) }
+    }));
+
+    service_manager_t manager({ locator.endpoint() }, 1);
+
+    auto lhs = manager.create<cocaine::io::storage_tag>("storage", service_options_t());
+    auto rhs = manager.create<cocaine::io::storage_tag>("storage-replica", service_options_t());
+
+    EXPECT_EQ("le value", lhs.invoke<cocaine::io::storage::read>("collection", "key").get());
+    EXPECT_EQ("le value", rhs.invoke<cocaine::io::storage::read>("collection", "key").get());
+
+    EXPECT_EQ(2, backend.connections());
+    EXPECT_EQ(1, locator.connections());
+}
+
+TEST(service, LocatorTimeoutKeepsSession) {
+    stub_t backend(storage(std::chrono::milliseconds(0)));
+
+    const std::map<std::string, stub_service_t> services = {
+        { "storage", stub_service_t({ backend.endpoint() }, STORAGE_VERSION) },
+        { "storage-replica", stub_service_t({ backend.endpoint() }, STORAGE_VERSION) }
+    };
+
+    stub_t slow(util::locator(services, std::chrono::milliseconds(500)));
+
+    service_manager_t manager({ slow.endpoint() }, 1);
+
+    service_options_t options;
+    options.resolve.timeout = std::chrono::milliseconds(100);
+
+    auto lhs = manager.create<cocaine::io::storage_tag>("storage", options);
+    auto rhs = manager.create<cocaine::io::storage_tag>("storage-replica", options);
+
+    EXPECT_THROW(lhs.invoke<cocaine::io::storage::read>("collection", "key").get(), std::exception);
+    EXPECT_THROW(rhs.invoke<cocaine::io::storage::read>("collection", "key").get(), std::exception);
+
+    // Only the timed out resolves are given up on, the shared Locator session is kept.
+    EXPECT_EQ(2, slow.invocations());
+    EXPECT_EQ(1, slow.connections());
+}
+
+TEST(service, QuarantinedSessionFailsFast) {
+    boost::asio::ip::tcp::endpoint endpoint;
+    {
+        // Nothing listens there after the stub is destroyed.
+        stub_t backend(storage(std::chrono::milliseconds(0)));
+        endpoint = backend.endpoint();
+    }
+
+    stub_t locator(util::locator({{ "storage", stub_service_t({ endpoint }, STORAGE_VERSION) }}));
+
+    service_manager_t manager({ locator.endpoint() }, 1);
+
+    service_options_t options;
+    options.quarantine = std::chrono::milliseconds(60000);
+    auto storage = manager.create<cocaine::io::storage_tag>("storage", options);
+
+    EXPECT_THROW(storage.invoke<cocaine::io::storage::read>("collection", "key").get(), std::exception);
+    EXPECT_THROW(storage.invoke<cocaine::io::storage::read>("collection", "key").get(), std::exception);
+
+    // The second invocation fails with the last connection error without resolving again.
+    EXPECT_EQ(1, locator.invocations());
+}
+
+TEST(service, BroadcastLabelsRepliesWithEndpoints) {
+    stub_t lhs(storage(std::chrono::milliseconds(0), "lhs"));
+    stub_t rhs(storage(std::chrono::milliseconds(0), "rhs"));
+    stub_t locator(util::locator({
+        { "storage", stub_service_t({ lhs.endpoint(), rhs.endpoint() }, STORAGE_VERSION) }
+    }));
+
+    service_manager_t manager({ locator.endpoint() }, 1);
+
+    service_options_t options;
+    options.spread = true;
+    auto storage = manager.create<cocaine::io::storage_tag>("storage", options);
+
+    auto replies = storage.broadcast<cocaine::io::storage::read>(std::chrono::milliseconds(0), "collection", "key").get();
+    ASSERT_EQ(2, replies.size());
+
+    std::map<boost::asio::ip::tcp::endpoint, std::string> results;
+    for (auto& reply : replies) {
+        results[reply.endpoint] = reply.result.get();
+    }
+
+    EXPECT_EQ("lhs", results[lhs.endpoint()]);
+    EXPECT_EQ("rhs", results[rhs.endpoint()]);
+}
+
+TEST(service, BroadcastExpiresBeforeResolving) {
+    stub_t backend(storage(std::chrono::milliseconds(0)));
+    stub_t locator(util::locator({
+        { "storage", stub_service_t({ backend.endpoint() }, STORAGE_VERSION) }
+    }, std::chrono::milliseconds(500)));
+
+    service_manager_t manager({ locator.endpoint() }, 1);
+
+    service_options_t options;
+    options.spread = true;
+    auto storage = manager.create<cocaine::io::storage_tag>("storage", options);
+
+    auto future = storage.broadcast<cocaine::io::storage::read>(std::chrono::milliseconds(50), "collection", "key");
+
+    try {
+        future.get();
+        FAIL() << "the broadcast must time out";
+    } catch (const std::system_error& err) {
+        EXPECT_EQ(std::error_code(asio::error::timed_out), err.code());
+    }
+}
+
+TEST(service, BroadcastRequiresSpread) {
+    stub_t lhs(storage(std::chrono::milliseconds(0), "lhs"));
+    stub_t rhs(storage(std::chrono::milliseconds(0), "rhs"));
+    stub_t locator(util::locator({
+        { "storage", stub_service_t({ lhs.endpoint(), rhs.endpoint() }, STORAGE_VERSION) }
+    }));
+
+    service_manager_t manager({ locator.endpoint() }, 1);
+    auto storage = manager.create<cocaine::io::storage_tag>("storage");
+
+    // All sessions share a single endpoint without spread mode, so the broadcast is rejected
+    // instead of reaching one replica only.
+    auto future = storage.broadcast<cocaine::io::storage::read>(std::chrono::milliseconds(0), "collection", "key");
+
+    try {
+        future.get();
+        FAIL() << "the broadcast must be rejected";
+    } catch (const std::system_error& err) {
+        EXPECT_EQ(std::error_code(asio::error::operation_not_supported), err.code());
+    }
+
+    EXPECT_EQ(0, lhs.invocations() + rhs.invocations());
+}
@@ -0,0 +1,84 @@
+#include <string>
+
+#include <unistd.h>
+
+#include <gtest/gtest.h>
+
+#include <cocaine/framework/detail/snapshot.hpp>
+
+using namespace cocaine::framework::detail;
+
+namespace {
+
+auto temporary(const std::string& name) -> std::string {
+    return "/tmp/cocaine-framework-" + name + "-" + std::to_string(::getpid());
+}
+
+} // namespace
+
+TEST(Snapshot, RoundTrip) {
+    const auto path = temporary("snapshot");
+
+    snapshot_t snapshot;
+    snapshot["storage"].endpoints = {
+        resolver_t::endpoint_type(boost::asio::ip::address::from_string("127.0.0.1"), 10053),
+        resolver_t::endpoint_type(boost::asio::ip::address::from_string("::1"), 10054)
+    };
+    snapshot["storage"].version = 1;
+    snapshot["logging"].version = 2;
+
+    write_snapshot(path, snapshot);
+    const auto loaded = read_snapshot(path);
+    ::unlink(path.c_str());
+
+    ASSERT_EQ(2, loaded.size());
+    EXPECT_EQ(snapshot.at("storage").endpoints, loaded.at("storage").endpoints);
+    EXPECT_EQ(1, loaded.at("storage").version);
+    EXPECT_TRUE(loaded.at("logging").endpoints.empty());
+    EXPECT_EQ(2, loaded.at("logging").version);
+    EXPECT_TRUE(read_snapshot(path).empty());
+}
+
+TEST(Snapshot, RejectsOverflow) {
+    const auto path = temporary("overflow");
+
+    snapshot_t snapshot;
+    snapshot["storage"].version = 1;
+    write_snapshot(path, snapshot);
+
+    snapshot_t names;
+    names[std::string(70000, 'x')].version = 1;
+    EXPECT_THROW(write_snapshot(path, names), std::runtime_error);
+
+    snapshot_t endpoints;
+    endpoints["storage"].endpoints.resize(70000);
+    EXPECT_THROW(write_snapshot(path, endpoints), std::runtime_error);
+
+    // The previous snapshot stays intact.
+    const auto loaded = read_snapshot(path);
+    ::unlink(path.c_str());
+
+    ASSERT_EQ(1, loaded.size());
+    EXPECT_EQ(1, loaded.at("storage").version);
+}
+
+TEST(Snapshot, WriterKeepsLatestVersion) {
+    const auto path = temporary("writer");
+
+    {
+        snapshot_writer_t writer(path);
+
+        for (unsigned int version = 1; version <= 100; ++version) {
+            snapshot_t snapshot;
+            snapshot["storage"].version = version;
+            EXPECT_EQ(version, writer.write(std::move(snapshot)));
+        }
+    }
+
+    // The writer flushes the latest snapshot on destruction.
+    const auto loaded = read_snapshot(path);
+    ::unlink(path.c_str());
+
+    ASSERT_EQ(1, loaded.size());
+    EXPECT_EQ(100, loaded.at("storage").version);
+}
@@ -0,0 +1,37 @@
+#include "alloc.hpp"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+namespace {
+
+std::atomic<std::uint64_t> counter(0);
+
+} // namespace
+
+auto testing::load::allocations() -> std::uint64_t {
+    return counter.load(std::memory_order_relaxed);
+}
+
+void* operator new(std::size_t size) {
+    counter.fetch_add(1, std::memory_order_relaxed);
+
+    if (void* ptr = std::malloc(size == 0 ? 1 : size)) {
+        return ptr;
+    }
+
+    throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size) {
+    return ::operator new(size);
+}
+
+void operator delete(void* ptr) noexcept {
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr) noexcept {
+    std::free(ptr);
+}
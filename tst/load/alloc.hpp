@@ -0,0 +1,12 @@
+#pragma once
+
+#include <cstdint>
+
+namespace testing { namespace load {
+
+/// Returns the number of heap allocations made by the process so far.
+///
+/// Counted by the global operator new replacement linked into the load test binary.
+auto allocations() -> std::uint64_t;
+
+} } // namespace testing::load
@@ -0,0 +1,101 @@
+#include <gtest/gtest.h>
+
+#include <cocaine/idl/logging.hpp>
+#include <cocaine/idl/storage.hpp>
+
+#include <cocaine/framework/forwards.hpp>
+#include <cocaine/framework/manager.hpp>
+#include <cocaine/framework/scheduler.hpp>
+#include <cocaine/framework/service.hpp>
+
+#include <cocaine/framework/detail/loop.hpp>
+#include <cocaine/framework/detail/resolver.hpp>
+
+#include "../../util/net.hpp"
+#include "../config.hpp"
+
+using namespace cocaine::framework;
+using namespace cocaine::framework::detail;
+
+using namespace testing;
+using namespace testing::load;
+using namespace testing::util;
+
+// Compares resolving through a fresh Locator connection each time with resolving over the single
+// persistent one, both sequentially and with the given number of concurrent resolves in flight.
+//
+// For example: load.service.locator.resolve 1000 100
+TEST(load, service_locator_resolve) {
+    uint iters = 1000;
+    uint concurrency = 100;
+    load_config("load.service.locator.resolve", iters, concurrency);
+
+    client_t client;
+    event_loop_t loop { client.loop() };
+    scheduler_t scheduler(loop);
+
+    resolver_t persistent(scheduler);
+
+    for (bool reused : { false, true }) {
+        for (uint inflight : { 1u, concurrency }) {
+            const auto now = std::chrono::high_resolution_clock::now();
+
+            for (uint id = 0; id < iters; id += inflight) {
+                std::vector<std::unique_ptr<resolver_t>> resolvers;
+                std::vector<task<resolver_t::result_t>::future_type> futures;
+
+                for (uint i = 0; i < inflight; ++i) {
+                    if (reused) {
+                        futures.push_back(persistent.resolve("storage"));
+                    } else {
+                        resolvers.emplace_back(new resolver_t(scheduler));
+                        futures.push_back(resolvers.back()->resolve("storage"));
+                    }
+                }
+
+                for (auto& future : futures) {
+                    EXPECT_FALSE(future.get().endpoints.empty());
+                }
+            }
+
+            const auto elapsed = std::chrono::duration<double>(
+                std::chrono::high_resolution_clock::now() - now
+            ).count();
+
+            std::cout << (reused ? "persistent" : "per-resolve") << " connection, "
+                      << inflight << " in flight: " << iters / elapsed << " resolves/s" << std::endl;
+        }
+    }
+}
+
+// Measures the startup time of a process using several services, i.e. the time until all of them
+// are connected, with and without prefetching their endpoints in a single round.
+//
+// For example: load.service.locator.prefetch 100
+TEST(load, service_locator_prefetch) {
+    uint iters = 100;
+    load_config("load.service.locator.prefetch", iters);
+
+    for (bool prefetch : { false, true }) {
+        double total = 0;
+
+        for (uint id = 0; id < iters; ++id) {
+            service_manager_t manager(1);
+
+            const auto now = std::chrono::high_resolution_clock::now();
+
+            if (prefetch) {
+                manager.prefetch({ "storage", "logging" }).get();
+            }
+
+            manager.create<cocaine::io::storage_tag>("storage").connect().get();
+            manager.create<cocaine::io::log_tag>("logging").connect().get();
+
+            total += std::chrono::duration<double, std::milli>(
+                std::chrono::high_resolution_clock::now() - now
+            ).count();
+        }
+
+        std::cout << (prefetch ? "prefetched" : "on demand") << ": " << total / iters << " ms" << std::endl;
+    }
+}
@@ -7,6 +7,7 @@
 #include <cocaine/framework/service.hpp>
 #include <cocaine/framework/manager.hpp>
 
+#include "../alloc.hpp"
 #include "../config.hpp"
 #include "../stats.hpp"
 
@@ -60,3 +61,129 @@ TEST(load, service_storage) {
 
     EXPECT_EQ(iters, counter);
 }
+
+// Measures read throughput depending on the number of pooled connections, doubling the pool size
+// on each round until the configured maximum is reached.
+//
+// For example: load.service.storage.pool 10000 8
+TEST(load, service_storage_pool) {
+    uint iters = 10000;
+    uint pool  = 8;
+    load_config("load.service.storage.pool", iters, pool);
+
+    service_manager_t manager;
+
+    for (uint size = 1; size <= pool; size *= 2) {
+        std::atomic<int> counter(0);
+
+        service_options_t options;
+        options.pool = size;
+
+        auto storage = manager.create<cocaine::io::storage_tag>("storage", options);
+        storage.connect().get();
+
+        std::vector<task<void>::future_type> futures;
+        futures.reserve(iters);
+
+        const auto now = std::chrono::high_resolution_clock::now();
+        {
+            stats_guard_t stats(iters);
+
+            for (uint id = 0; id < iters; ++id) {
+                load_context context(id, counter, stats.stats);
+
+                futures.emplace_back(
+                    storage.invoke<io::storage::read>("collection", "key")
+                        .then(std::bind(&load::service::storage::on_invoke, ph::_1))
+                        .then(std::bind(&finalize, ph::_1, std::move(context)))
+                );
+            }
+
+            for (auto& future : futures) {
+                future.get();
+            }
+        }
+
+        const auto elapsed = std::chrono::duration<double>(
+            std::chrono::high_resolution_clock::now() - now
+        ).count();
+
+        std::cout << "pool " << size << ": " << iters / elapsed << " rps" << std::endl;
+
+        EXPECT_EQ(iters, counter);
+    }
+}
+
+// Measures the cost of a single invocation over an already established connection, by issuing
+// invocations one after another. Each event loop hop adds latency and most of them allocate, so
+// both the round trip time and the number of allocations per call are reported.
+//
+// For example: load.service.storage.sequential 10000
+TEST(load, service_storage_sequential) {
+    uint iters = 10000;
+    load_config("load.service.storage.sequential", iters);
+
+    service_manager_t manager(1);
+    auto storage = manager.create<cocaine::io::storage_tag>("storage");
+    storage.connect().get();
+
+    // Warm up lazily initialized internals.
+    EXPECT_EQ("le value", storage.invoke<io::storage::read>("collection", "key").get());
+
+    const auto allocations = load::allocations();
+    const auto now = std::chrono::high_resolution_clock::now();
+
+    for (uint id = 0; id < iters; ++id) {
+        EXPECT_EQ("le value", storage.invoke<io::storage::read>("collection", "key").get());
+    }
+
+    const auto elapsed = std::chrono::duration<double, std::micro>(
+        std::chrono::high_resolution_clock::now() - now
+    ).count();
+
+    std::cout << "latency: " << elapsed / iters << " us/call, "
+              << "allocations: " << static_cast<double>(load::allocations() - allocations) / iters
+              << " per call" << std::endl;
+}
+
+// Compares sending invocations one by one with sending them as batches of the given size.
+//
+// For example: load.service.storage.batch 10000 100
+TEST(load, service_storage_batch) {
+    uint iters = 10000;
+    uint size  = 100;
+    load_config("load.service.storage.batch", iters, size);
+
+    service_manager_t manager;
+    auto storage = manager.create<cocaine::io::storage_tag>("storage");
+    storage.connect().get();
+
+    const std::vector<std::tuple<std::string, std::string>> batch(size, std::make_tuple("collection", "key"));
+
+    for (bool batched : { false, true }) {
+        std::vector<task<std::string>::future_type> futures;
+        futures.reserve(iters);
+
+        const auto now = std::chrono::high_resolution_clock::now();
+
+        while (futures.size() < iters) {
+            if (batched) {
+                for (auto& future : storage.batch<io::storage::read>(batch)) {
+                    futures.push_back(std::move(future));
+                }
+            } else {
+                futures.push_back(storage.invoke<io::storage::read>("collection", "key"));
+            }
+        }
+
+        for (auto& future : futures) {
+            EXPECT_EQ("le value", future.get());
+        }
+
+        const auto elapsed = std::chrono::duration<double>(
+            std::chrono::high_resolution_clock::now() - now
+        ).count();
+
+        std::cout << (batched ? "batched: " : "single: ") << futures.size() / elapsed << " rps" << std::endl;
+    }
+}
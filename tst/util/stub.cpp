@@ -0,0 +1,207 @@
+#include "stub.hpp"
+
+#include <cstring>
+
+#include <boost/thread/barrier.hpp>
+
+#include <asio/deadline_timer.hpp>
+#include <asio/write.hpp>
+
+#include <cocaine/errors.hpp>
+#include <cocaine/idl/locator.hpp>
+#include <cocaine/traits/endpoint.hpp>
+#include <cocaine/traits/error_code.hpp>
+#include <cocaine/traits/graph.hpp>
+#include <cocaine/traits/tuple.hpp>
+#include <cocaine/traits/vector.hpp>
+
+#include <cocaine/framework/detail/net.hpp>
+
+namespace ph = std::placeholders;
+
+using namespace testing::util;
+
+namespace {
+
+const std::size_t READ_SIZE = 4096;
+
+void
+on_write(std::shared_ptr<stub_connection_t> connection, std::shared_ptr<std::string> data) {
+    std::error_code ec;
+    asio::write(connection->socket(), asio::buffer(*data), ec);
+}
+
+void
+on_delay(const std::error_code& ec,
+         std::shared_ptr<asio::deadline_timer> /* timer */,
+         std::shared_ptr<stub_connection_t> connection,
+         std::shared_ptr<std::string> data)
+{
+    if (!ec) {
+        on_write(std::move(connection), std::move(data));
+    }
+}
+
+void
+on_close(std::shared_ptr<stub_connection_t> connection) {
+    std::error_code ec;
+    connection->socket().close(ec);
+}
+
+void
+on_resolve(std::shared_ptr<stub_connection_t> connection,
+           std::uint64_t span,
+           std::uint64_t id,
+           const msgpack::object& args,
+           const std::map<std::string, stub_service_t>& services,
+           std::chrono::milliseconds delay)
+{
+    if (id != cocaine::io::event_traits<cocaine::io::locator::resolve>::id) {
+        return;
+    }
+
+    const auto name = args.via.array.ptr[0].as<std::string>();
+
+    auto it = services.find(name);
+    if (it == services.end()) {
+        connection->fail<cocaine::io::locator::resolve>(
+            span,
+            cocaine::error::make_error_code(cocaine::error::locator_errors::service_not_available),
+            "service is not available"
+        );
+        return;
+    }
+
+    connection->delayed<cocaine::io::locator::resolve>(
+        delay,
+        span,
+        fw::detail::endpoints_cast<asio::ip::tcp::endpoint>(std::get<0>(it->second)),
+        std::get<1>(it->second),
+        cocaine::io::graph_root_t()
+    );
+}
+
+} // namespace
+
+stub_connection_t::stub_connection_t(fw::detail::loop_t& loop) :
+    loop(loop),
+    socket_(loop)
+{}
+
+asio::ip::tcp::socket&
+stub_connection_t::socket() {
+    return socket_;
+}
+
+void
+stub_connection_t::send(const cocaine::io::encoder_t::message_type& message, std::chrono::milliseconds delay) {
+    auto data = std::make_shared<std::string>(message.data(), message.size());
+
+    if (delay.count() == 0) {
+        loop.post(std::bind(&::on_write, shared_from_this(), data));
+        return;
+    }
+
+    auto timer = std::make_shared<asio::deadline_timer>(loop);
+    timer->expires_from_now(boost::posix_time::milliseconds(delay.count()));
+    timer->async_wait(std::bind(&::on_delay, ph::_1, timer, shared_from_this(), data));
+}
+
+void
+stub_connection_t::close() {
+    loop.post(std::bind(&::on_close, shared_from_this()));
+}
+
+void
+stub_connection_t::listen(std::function<void(std::shared_ptr<stub_connection_t>, const msgpack::object&)> fn) {
+    unpacker.reserve_buffer(READ_SIZE);
+    socket_.async_read_some(
+        asio::buffer(unpacker.buffer(), unpacker.buffer_capacity()),
+        std::bind(&stub_connection_t::on_read, shared_from_this(), ph::_1, ph::_2, std::move(fn))
+    );
+}
+
+void
+stub_connection_t::on_read(const std::error_code& ec,
+                           std::size_t size,
+                           std::function<void(std::shared_ptr<stub_connection_t>, const msgpack::object&)> fn)
+{
+    if (ec) {
+        return;
+    }
+
+    unpacker.buffer_consumed(size);
+
+    msgpack::unpacked result;
+    while (unpacker.next(&result)) {
+        fn(shared_from_this(), result.get());
+    }
+
+    listen(std::move(fn));
+}
+
+stub_t::stub_t(handler_type handler) :
+    work(new fw::detail::loop_t::work(loop)),
+    acceptor(loop, asio::ip::tcp::endpoint(asio::ip::address_v4::loopback(), 0)),
+    handler(std::move(handler)),
+    invocations_(0),
+    connections_(0)
+{
+    accept();
+
+    thread = boost::thread(static_cast<std::size_t(fw::detail::loop_t::*)()>(&fw::detail::loop_t::run), std::ref(loop));
+}
+
+stub_t::~stub_t() {
+    work.reset();
+    loop.stop();
+    thread.join();
+}
+
+boost::asio::ip::tcp::endpoint
+stub_t::endpoint() const {
+    return fw::detail::endpoint_cast(acceptor.local_endpoint());
+}
+
+std::size_t
+stub_t::invocations() const {
+    return invocations_;
+}
+
+std::size_t
+stub_t::connections() const {
+    return connections_;
+}
+
+void
+stub_t::accept() {
+    auto connection = std::make_shared<stub_connection_t>(loop);
+    acceptor.async_accept(connection->socket(), std::bind(&stub_t::on_accept, this, ph::_1, connection));
+}
+
+void
+stub_t::on_accept(const std::error_code& ec, std::shared_ptr<stub_connection_t> connection) {
+    if (ec) {
+        return;
+    }
+
+    ++connections_;
+    connection->listen(std::bind(&stub_t::on_message, this, ph::_1, ph::_2));
+
+    accept();
+}
+
+void
+stub_t::on_message(std::shared_ptr<stub_connection_t> connection, const msgpack::object& message) {
+    ++invocations_;
+
+    const auto span = message.via.array.ptr[0].as<std::uint64_t>();
+    const auto id = message.via.array.ptr[1].as<std::uint64_t>();
+
+    handler(std::move(connection), span, id, message.via.array.ptr[2]);
+}
+
+stub_t::handler_type
+testing::util::locator(std::map<std::string, stub_service_t> services, std::chrono::milliseconds delay) {
+    return std::bind(&::on_resolve, ph::_1, ph::_2, ph::_3, ph::_4, std::move(services), delay);
+}
@@ -0,0 +1,155 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/thread/thread.hpp>
+
+#include <asio/ip/tcp.hpp>
+
+#include <msgpack.hpp>
+
+#include <cocaine/rpc/asio/encoder.hpp>
+#include <cocaine/rpc/protocol.hpp>
+
+#include <cocaine/framework/detail/forwards.hpp>
+
+namespace testing {
+
+namespace util {
+
+namespace fw = cocaine::framework;
+
+/// Connection accepted by a stub service.
+class stub_connection_t : public std::enable_shared_from_this<stub_connection_t> {
+    fw::detail::loop_t& loop;
+    asio::ip::tcp::socket socket_;
+    msgpack::unpacker unpacker;
+
+public:
+    explicit
+    stub_connection_t(fw::detail::loop_t& loop);
+
+    asio::ip::tcp::socket&
+    socket();
+
+    /// Sends the value response to the invocation of the given event.
+    template<class Event, class... Args>
+    void
+    reply(std::uint64_t span, const Args&... args) {
+        send(cocaine::io::encoded<typename scope<Event>::value>(span, args...));
+    }
+
+    /// Sends the value response to the invocation of the given event after the delay.
+    template<class Event, class... Args>
+    void
+    delayed(std::chrono::milliseconds delay, std::uint64_t span, const Args&... args) {
+        send(cocaine::io::encoded<typename scope<Event>::value>(span, args...), delay);
+    }
+
+    /// Sends the error response to the invocation of the given event.
+    template<class Event>
+    void
+    fail(std::uint64_t span, const std::error_code& ec, const std::string& reason) {
+        send(cocaine::io::encoded<typename scope<Event>::error>(span, ec, reason));
+    }
+
+    /// Writes the given message on the stub event loop, optionally after the delay.
+    ///
+    /// May be called from any thread, messages sent without a delay are written in order.
+    void
+    send(const cocaine::io::encoder_t::message_type& message,
+         std::chrono::milliseconds delay = std::chrono::milliseconds(0));
+
+    /// Closes the connection on the stub event loop.
+    void
+    close();
+
+    /// Starts reading invocations, passing each of them to the given function.
+    void
+    listen(std::function<void(std::shared_ptr<stub_connection_t>, const msgpack::object&)> fn);
+
+private:
+    template<class Event>
+    struct scope {
+        typedef typename cocaine::io::event_traits<Event>::upstream_type upstream_type;
+        typedef typename cocaine::io::protocol<upstream_type>::scope type;
+        typedef typename type::value value;
+        typedef typename type::error error;
+    };
+
+    void
+    on_read(const std::error_code& ec,
+            std::size_t size,
+            std::function<void(std::shared_ptr<stub_connection_t>, const msgpack::object&)> fn);
+};
+
+/// Fake Cocaine service listening on a random local port with its own event loop thread.
+///
+/// Each received message is passed to the handler on the event loop thread, so the handler should
+/// reply using delayed messages to emulate a slow service instead of blocking.
+class stub_t {
+public:
+    typedef std::function<void(std::shared_ptr<stub_connection_t>, std::uint64_t span, std::uint64_t id, const msgpack::object& args)> handler_type;
+
+private:
+    fw::detail::loop_t loop;
+    std::unique_ptr<fw::detail::loop_t::work> work;
+    asio::ip::tcp::acceptor acceptor;
+    handler_type handler;
+
+    std::atomic<std::size_t> invocations_;
+    std::atomic<std::size_t> connections_;
+
+    boost::thread thread;
+
+public:
+    explicit
+    stub_t(handler_type handler);
+
+    ~stub_t();
+
+    /// Returns the local endpoint the stub is listening on.
+    boost::asio::ip::tcp::endpoint
+    endpoint() const;
+
+    /// Returns the number of messages received over all connections.
+    std::size_t
+    invocations() const;
+
+    /// Returns the number of accepted connections.
+    std::size_t
+    connections() const;
+
+private:
+    void
+    accept();
+
+    void
+    on_accept(const std::error_code& ec, std::shared_ptr<stub_connection_t> connection);
+
+    void
+    on_message(std::shared_ptr<stub_connection_t> connection, const msgpack::object& message);
+};
+
+/// Resolved service description: its endpoints and protocol version.
+typedef std::tuple<std::vector<boost::asio::ip::tcp::endpoint>, unsigned int> stub_service_t;
+
+/// Returns a handler of a stub Locator, which resolves the given services after the delay.
+///
+/// Other services are replied with the `service_not_available` error.
+stub_t::handler_type
+locator(std::map<std::string, stub_service_t> services,
+        std::chrono::milliseconds delay = std::chrono::milliseconds(0));
+
+} // namespace util
+
+} // namespace testing